@@ -0,0 +1,104 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_errors.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace ww898 {
+namespace utf {
+
+// ISO-8859-1, every char is the code point [0x00‥0xFF]
+struct latin1 final
+{
+    static size_t const max_unicode_symbol_size = 1;
+    static size_t const max_supported_symbol_size = 1;
+
+    static uint32_t const max_supported_code_point = 0xFF;
+
+    using char_type = uint8_t;
+
+    template<typename PeekFn>
+    static WW898_UTF_CONSTEXPR14 size_t char_size(PeekFn &&)
+    {
+        return 1;
+    }
+
+    template<typename ReadFn>
+    static WW898_UTF_CONSTEXPR14 uint32_t read(ReadFn && read_fn)
+    {
+        char_type const ch = std::forward<ReadFn>(read_fn)();
+        return ch;
+    }
+
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn &&)
+    {
+        return 1;
+    }
+
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        return read(std::forward<ReadBackFn>(read_back_fn));
+    }
+
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const &, uint32_t & cp)
+    {
+        char_type const ch = *it++;
+        cp = ch;
+        return utf_error::none;
+    }
+
+    static WW898_UTF_CONSTEXPR14 bool encodable(uint32_t const cp) throw()
+    {
+        return cp < 0x100;
+    }
+
+    // Writes the code point which is `encodable`, never throws
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void encode(uint32_t const cp, WriteFn && write_fn)
+    {
+        std::forward<WriteFn>(write_fn)(static_cast<char_type>(cp));
+    }
+
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void write(uint32_t const cp, WriteFn && write_fn)
+    {
+        if (cp < 0x100)
+            encode(cp, std::forward<WriteFn>(write_fn));
+        else
+            throw std::runtime_error("Too large latin1 code point");
+    }
+};
+
+}}
@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <ww898/utf_errors.hpp>
+#include <ww898/utf_config.hpp>
+
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
@@ -55,7 +58,7 @@ struct utf16 final
     static char_type const max_surrogate_low = 0xDFFF;
 
     template<typename PeekFn>
-    static size_t char_size(PeekFn && peek_fn)
+    static WW898_UTF_CONSTEXPR14 size_t char_size(PeekFn && peek_fn)
     {
         char_type const ch0 = std::forward<PeekFn>(peek_fn)();
         if (ch0 < 0xD800) // [0x0000‥0xD7FF]
@@ -69,7 +72,7 @@ struct utf16 final
     }
 
     template<typename ReadFn>
-    static uint32_t read(ReadFn && read_fn)
+    static WW898_UTF_CONSTEXPR14 uint32_t read(ReadFn && read_fn)
     {
         char_type const ch0 = read_fn();
         if (ch0 < 0xD800) // [0x0000‥0xD7FF]
@@ -85,25 +88,83 @@ struct utf16 final
         return ch0;
     }
 
-    template<typename WriteFn>
-    static void write(uint32_t const cp, WriteFn && write_fn)
+    // Returns the size of the symbol which ends at the position, `read_back_fn` returns the previous char
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn && read_back_fn)
     {
-        if (cp < 0xD800) // [0x0000‥0xD7FF]
-            write_fn(static_cast<char_type>(cp));
-        else if (cp < 0x10000)
+        char_type const ch1 = read_back_fn();
+        if (ch1 < 0xD800 || ch1 >= 0xE000) // [0x0000‥0xD7FF] [0xE000‥0xFFFF]
+            return 1;
+        if (ch1 < 0xDC00)
+            throw std::runtime_error("The low utf16 surrogate char is expected");
+        char_type const ch0 = read_back_fn(); if (ch0 >> 10 != 0x36) throw std::runtime_error("The high utf16 surrogate char is expected");
+        return 2;
+    }
+
+    // Decodes the symbol which ends at the position, `read_back_fn` returns the previous char
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        char_type const ch1 = read_back_fn();
+        if (ch1 < 0xD800 || ch1 >= 0xE000) // [0x0000‥0xD7FF] [0xE000‥0xFFFF]
+            return ch1;
+        if (ch1 < 0xDC00)
+            throw std::runtime_error("The low utf16 surrogate char is expected");
+        // [0xD800‥0xDBFF] [0xDC00‥0xDFFF]
+        char_type const ch0 = read_back_fn(); if (ch0 >> 10 != 0x36) throw std::runtime_error("The high utf16 surrogate char is expected");
+        return static_cast<uint32_t>((ch0 << 10) + ch1 - 0x35FDC00);
+    }
+
+    // Decodes the symbol without exceptions. On error `it` is left after the unpaired surrogate.
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const & eit, uint32_t & cp)
+    {
+        char_type const ch0 = *it++;
+        if (ch0 < 0xD800 || ch0 >= 0xE000) // [0x0000‥0xD7FF] [0xE000‥0xFFFF]
         {
-            if (cp < 0xE000)
-                throw std::runtime_error("The utf16 code point can not be in surrogate range");
-            // [0xE000‥0xFFFF]
-            write_fn(static_cast<char_type>(cp));
+            cp = ch0;
+            return utf_error::none;
         }
-        else if (cp < 0x110000) // [0xD800‥0xDBFF] [0xDC00‥0xDFFF]
+        if (ch0 >= 0xDC00)
+            return utf_error::invalid_lead;
+        if (it == eit)
+            return utf_error::not_enough_input;
+        char_type const ch1 = *it;
+        if (ch1 >> 10 != 0x37)
+            return utf_error::invalid_slave;
+        ++it;
+        cp = static_cast<uint32_t>((ch0 << 10) + ch1 - 0x35FDC00);
+        return utf_error::none;
+    }
+
+    static WW898_UTF_CONSTEXPR14 bool encodable(uint32_t const cp) throw()
+    {
+        return cp < 0x110000 && cp >> 11 != 0x1B;
+    }
+
+    // Writes the code point which is `encodable`, never throws
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void encode(uint32_t const cp, WriteFn && write_fn)
+    {
+        if (cp < 0x10000) // [0x0000‥0xD7FF] [0xE000‥0xFFFF]
+            write_fn(static_cast<char_type>(cp));
+        else // [0xD800‥0xDBFF] [0xDC00‥0xDFFF]
         {
             write_fn(static_cast<char_type>(0xD7C0 + (cp >> 10        )));
             write_fn(static_cast<char_type>(0xDC00 + (cp       & 0x3FF)));
         }
-        else
+    }
+
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void write(uint32_t const cp, WriteFn && write_fn)
+    {
+        if (cp >= 0x110000)
             throw std::runtime_error("Too large the utf16 code point");
+        if (cp >> 11 == 0x1B)
+            throw std::runtime_error("The utf16 code point can not be in surrogate range");
+        encode(cp, write_fn);
     }
 };
 
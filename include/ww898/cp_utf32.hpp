@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <ww898/utf_errors.hpp>
+#include <ww898/utf_config.hpp>
+
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
@@ -41,13 +44,13 @@ struct utf32 final
     using char_type = uint32_t;
 
     template<typename PeekFn>
-    static size_t char_size(PeekFn &&)
+    static WW898_UTF_CONSTEXPR14 size_t char_size(PeekFn &&)
     {
         return 1;
     }
 
     template<typename ReadFn>
-    static uint32_t read(ReadFn && read_fn)
+    static WW898_UTF_CONSTEXPR14 uint32_t read(ReadFn && read_fn)
     {
         char_type const ch = std::forward<ReadFn>(read_fn)();
         if (ch < 0x80000000)
@@ -55,11 +58,47 @@ struct utf32 final
         throw std::runtime_error("Too large utf32 char");
     }
 
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn &&)
+    {
+        return 1;
+    }
+
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        return read(std::forward<ReadBackFn>(read_back_fn));
+    }
+
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const &, uint32_t & cp)
+    {
+        char_type const ch = *it++;
+        if (ch >= 0x80000000)
+            return utf_error::invalid_code_point;
+        cp = ch;
+        return utf_error::none;
+    }
+
+    static WW898_UTF_CONSTEXPR14 bool encodable(uint32_t const cp) throw()
+    {
+        return cp < 0x80000000;
+    }
+
+    // Writes the code point which is `encodable`, never throws
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void encode(uint32_t const cp, WriteFn && write_fn)
+    {
+        std::forward<WriteFn>(write_fn)(static_cast<char_type>(cp));
+    }
+
     template<typename WriteFn>
-    static void write(uint32_t const cp, WriteFn && write_fn)
+    static WW898_UTF_CONSTEXPR14 void write(uint32_t const cp, WriteFn && write_fn)
     {
         if (cp < 0x80000000)
-            std::forward<WriteFn>(write_fn)(static_cast<char_type>(cp));
+            encode(cp, std::forward<WriteFn>(write_fn));
         else
             throw std::runtime_error("Too large utf32 code point");
     }
@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <ww898/utf_errors.hpp>
+#include <ww898/utf_config.hpp>
+
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
@@ -48,7 +51,7 @@ struct utf8 final
     using char_type = uint8_t;
 
     template<typename PeekFn>
-    static size_t char_size(PeekFn && peek_fn)
+    static WW898_UTF_CONSTEXPR14 size_t char_size(PeekFn && peek_fn)
     {
         char_type const ch0 = std::forward<PeekFn>(peek_fn)();
         if (ch0 < 0x80) // 0xxx_xxxx
@@ -69,7 +72,7 @@ struct utf8 final
     }
 
     template<typename ReadFn>
-    static uint32_t read(ReadFn && read_fn)
+    static WW898_UTF_CONSTEXPR14 uint32_t read(ReadFn && read_fn)
     {
         char_type const ch0 = read_fn();
         if (ch0 < 0x80) // 0xxx_xxxx
@@ -78,81 +81,271 @@ struct utf8 final
             throw std::runtime_error("The utf8 first char in sequence is incorrect");
         if (ch0 < 0xE0) // 110x_xxxx 10xx_xxxx
         {
-            char_type const ch1 = read_fn(); if (ch1 >> 6 != 2) goto _err;
+            char_type const ch1 = read_slave(read_fn);
             return (ch0 << 6) + ch1 - 0x3080;
         }
         if (ch0 < 0xF0) // 1110_xxxx 10xx_xxxx 10xx_xxxx
         {
-            char_type const ch1 = read_fn(); if (ch1 >> 6 != 2) goto _err;
-            char_type const ch2 = read_fn(); if (ch2 >> 6 != 2) goto _err;
+            char_type const ch1 = read_slave(read_fn);
+            char_type const ch2 = read_slave(read_fn);
             return (ch0 << 12) + (ch1 << 6) + ch2 - 0xE2080;
         }
         if (ch0 < 0xF8) // 1111_0xxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
-            char_type const ch1 = read_fn(); if (ch1 >> 6 != 2) goto _err;
-            char_type const ch2 = read_fn(); if (ch2 >> 6 != 2) goto _err;
-            char_type const ch3 = read_fn(); if (ch3 >> 6 != 2) goto _err;
+            char_type const ch1 = read_slave(read_fn);
+            char_type const ch2 = read_slave(read_fn);
+            char_type const ch3 = read_slave(read_fn);
             return (ch0 << 18) + (ch1 << 12) + (ch2 << 6) + ch3 - 0x3C82080;
         }
         if (ch0 < 0xFC) // 1111_10xx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
-            char_type const ch1 = read_fn(); if (ch1 >> 6 != 2) goto _err;
-            char_type const ch2 = read_fn(); if (ch2 >> 6 != 2) goto _err;
-            char_type const ch3 = read_fn(); if (ch3 >> 6 != 2) goto _err;
-            char_type const ch4 = read_fn(); if (ch4 >> 6 != 2) goto _err;
-            return (ch0 << 24) + (ch1 << 18) + (ch2 << 12) + (ch3 << 6) + ch4 - 0xFA082080;
+            char_type const ch1 = read_slave(read_fn);
+            char_type const ch2 = read_slave(read_fn);
+            char_type const ch3 = read_slave(read_fn);
+            char_type const ch4 = read_slave(read_fn);
+            return (static_cast<uint32_t>(ch0) << 24) + (ch1 << 18) + (ch2 << 12) + (ch3 << 6) + ch4 - 0xFA082080;
         }
         if (ch0 < 0xFE) // 1111_110x 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
-            char_type const ch1 = read_fn(); if (ch1 >> 6 != 2) goto _err;
-            char_type const ch2 = read_fn(); if (ch2 >> 6 != 2) goto _err;
-            char_type const ch3 = read_fn(); if (ch3 >> 6 != 2) goto _err;
-            char_type const ch4 = read_fn(); if (ch4 >> 6 != 2) goto _err;
-            char_type const ch5 = read_fn(); if (ch5 >> 6 != 2) goto _err;
-            return (ch0 << 30) + (ch1 << 24) + (ch2 << 18) + (ch3 << 12) + (ch4 << 6) + ch5 - 0x82082080;
+            char_type const ch1 = read_slave(read_fn);
+            char_type const ch2 = read_slave(read_fn);
+            char_type const ch3 = read_slave(read_fn);
+            char_type const ch4 = read_slave(read_fn);
+            char_type const ch5 = read_slave(read_fn);
+            return (static_cast<uint32_t>(ch0) << 30) + (static_cast<uint32_t>(ch1) << 24) +
+                (ch2 << 18) + (ch3 << 12) + (ch4 << 6) + ch5 - 0x82082080;
         }
         throw std::runtime_error("The utf8 first char in sequence is incorrect");
-        _err: throw std::runtime_error("The utf8 slave char in sequence is incorrect");
     }
 
+    // Returns the size of the symbol which ends at the position, `read_back_fn` returns the previous char
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn && read_back_fn)
+    {
+        size_t size = 1;
+        char_type ch;
+        while ((ch = read_back_fn()) >> 6 == 2)
+            if (++size > max_supported_symbol_size)
+                throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+        if (char_size([ch] { return ch; }) != size)
+            throw std::runtime_error("The utf8 first char in sequence is incorrect");
+        return size;
+    }
+
+    // Decodes the symbol which ends at the position, `read_back_fn` returns the previous char
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        char_type ch = read_back_fn();
+        if (ch < 0x80) // 0xxx_xxxx
+            return ch;
+        uint32_t res = 0;
+        size_t size = 1;
+        for (; ch >> 6 == 2; ch = read_back_fn()) // 10xx_xxxx
+        {
+            if (size == max_supported_symbol_size)
+                throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+            res |= static_cast<uint32_t>(ch & 0x3F) << 6 * (size++ - 1);
+        }
+        if (char_size([ch] { return ch; }) != size)
+            throw std::runtime_error("The utf8 first char in sequence is incorrect");
+        return res | static_cast<uint32_t>(ch & 0x7F >> size) << 6 * (size - 1);
+    }
+
+    // Decodes the symbol without exceptions. On error `it` is left after the lead char and the correct slave chars, so
+    // the next symbol starts from the first incorrect char.
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const & eit, uint32_t & cp)
+    {
+        char_type const ch0 = *it++;
+        if (ch0 < 0x80) // 0xxx_xxxx
+        {
+            cp = ch0;
+            return utf_error::none;
+        }
+        size_t const size =
+            ch0 < 0xC0 ? 0 :
+            ch0 < 0xE0 ? 2 :
+            ch0 < 0xF0 ? 3 :
+            ch0 < 0xF8 ? 4 :
+            ch0 < 0xFC ? 5 :
+            ch0 < 0xFE ? 6 : 0;
+        if (!size)
+            return utf_error::invalid_lead;
+        uint32_t res = ch0 & 0x7F >> size;
+        for (size_t n = 1; n < size; ++n)
+        {
+            if (it == eit)
+                return utf_error::not_enough_input;
+            char_type const ch = *it;
+            if (ch >> 6 != 2)
+                return utf_error::invalid_slave;
+            ++it;
+            res = res << 6 | (ch & 0x3F);
+        }
+        cp = res;
+        return utf_error::none;
+    }
+
+    static WW898_UTF_CONSTEXPR14 bool encodable(uint32_t const cp) throw()
+    {
+        return cp < 0x80000000;
+    }
+
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void write(uint32_t const cp, WriteFn && write_fn)
+    {
+        if (cp >= 0x80000000)
+            throw std::runtime_error("Tool large UTF8 code point");
+        encode(cp, write_fn);
+    }
+
+    // Writes the code point which is `encodable`, never throws
     template<typename WriteFn>
-    static void write(uint32_t const cp, WriteFn && write_fn)
+    static WW898_UTF_CONSTEXPR14 void encode(uint32_t const cp, WriteFn && write_fn)
     {
+        size_t size = 1;
         if (cp < 0x80)          // 0xxx_xxxx
             write_fn(static_cast<char_type>(cp));
         else if (cp < 0x800)    // 110x_xxxx 10xx_xxxx
         {
             write_fn(static_cast<char_type>(0xC0 | cp >>  6));
-            goto _1;
+            size = 2;
         }
         else if (cp < 0x10000)  // 1110_xxxx 10xx_xxxx 10xx_xxxx
         {
             write_fn(static_cast<char_type>(0xE0 | cp >> 12));
-            goto _2;
+            size = 3;
         }
         else if (cp < 0x200000) // 1111_0xxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
             write_fn(static_cast<char_type>(0xF0 | cp >> 18));
-            goto _3;
+            size = 4;
         }
         else if (cp < 0x4000000) // 1111_10xx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
             write_fn(static_cast<char_type>(0xF8 | cp >> 24));
-            goto _4;
+            size = 5;
         }
-        else if (cp < 0x80000000) // 1111_110x 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
+        else // 1111_110x 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
         {
             write_fn(static_cast<char_type>(0xFC | cp >> 30));
-            goto _5;
+            size = 6;
         }
-        else
-            throw std::runtime_error("Tool large UTF8 code point");
-        return;
-        _5: write_fn(static_cast<char_type>(0x80 | (cp >> 24 & 0x3F)));
-        _4: write_fn(static_cast<char_type>(0x80 | (cp >> 18 & 0x3F)));
-        _3: write_fn(static_cast<char_type>(0x80 | (cp >> 12 & 0x3F)));
-        _2: write_fn(static_cast<char_type>(0x80 | (cp >>  6 & 0x3F)));
-        _1: write_fn(static_cast<char_type>(0x80 | (cp       & 0x3F)));
+        // The slave chars, `goto` is not allowed in the constant expressions
+        switch (size)
+        {
+        case 6: write_fn(static_cast<char_type>(0x80 | (cp >> 24 & 0x3F))); // fall through
+        case 5: write_fn(static_cast<char_type>(0x80 | (cp >> 18 & 0x3F))); // fall through
+        case 4: write_fn(static_cast<char_type>(0x80 | (cp >> 12 & 0x3F))); // fall through
+        case 3: write_fn(static_cast<char_type>(0x80 | (cp >>  6 & 0x3F))); // fall through
+        case 2: write_fn(static_cast<char_type>(0x80 | (cp       & 0x3F)));
+        }
+    }
+
+    // Decodes the symbol from the contiguous input with at least `max_supported_symbol_size` chars left. The up to 4
+    // chars long symbols are read with the single 32-bit load and their slave chars are checked at once.
+    template<typename Ch>
+    static uint32_t read_block(Ch * & it)
+    {
+        Ch * const in = it;
+        char_type const ch0 = static_cast<char_type>(in[0]);
+        if (ch0 < 0x80) // 0xxx_xxxx
+        {
+            it = in + 1;
+            return ch0;
+        }
+        // The compilers merge the shifted chars into the single load
+        uint32_t const chs =
+            static_cast<uint32_t>(ch0) |
+            static_cast<uint32_t>(static_cast<char_type>(in[1])) <<  8 |
+            static_cast<uint32_t>(static_cast<char_type>(in[2])) << 16 |
+            static_cast<uint32_t>(static_cast<char_type>(in[3])) << 24;
+        if (ch0 < 0xC0)
+            throw std::runtime_error("The utf8 first char in sequence is incorrect");
+        if (ch0 < 0xE0) // 110x_xxxx 10xx_xxxx
+        {
+            if ((chs & 0xC000) != 0x8000)
+                throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+            it = in + 2;
+            return (chs & 0x1F) << 6 | (chs >> 8 & 0x3F);
+        }
+        if (ch0 < 0xF0) // 1110_xxxx 10xx_xxxx 10xx_xxxx
+        {
+            if ((chs & 0xC0C000) != 0x808000)
+                throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+            it = in + 3;
+            return (chs & 0x0F) << 12 | (chs >> 2 & 0xFC0) | (chs >> 16 & 0x3F);
+        }
+        if (ch0 < 0xF8) // 1111_0xxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
+        {
+            if ((chs & 0xC0C0C000) != 0x80808000)
+                throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+            it = in + 4;
+            return (chs & 0x07) << 18 | (chs << 4 & 0x3F000) | (chs >> 10 & 0xFC0) | (chs >> 24 & 0x3F);
+        }
+        return read([&it] { return *it++; });
+    }
+
+    // Encodes the code point which is `encodable` to the contiguous output, never throws. The up to 4 chars long
+    // symbols are built in the single 32-bit value and stored without the per-char branches.
+    template<typename Och>
+    static void write_block(uint32_t const cp, Och * & oit) throw()
+    {
+        // The 8-bit stores may alias the position itself, so it is kept in the local
+        Och * const out = oit;
+        if (cp < 0x80) // 0xxx_xxxx
+        {
+            out[0] = static_cast<Och>(cp);
+            oit = out + 1;
+            return;
+        }
+        if (cp < 0x800) // 110x_xxxx 10xx_xxxx
+        {
+            uint32_t const chs = 0x80C0 | cp >> 6 | (cp & 0x3F) << 8;
+            out[0] = static_cast<Och>(chs);
+            out[1] = static_cast<Och>(chs >> 8);
+            oit = out + 2;
+            return;
+        }
+        if (cp < 0x10000) // 1110_xxxx 10xx_xxxx 10xx_xxxx
+        {
+            uint32_t const chs = 0x8080E0 | cp >> 12 | (cp << 2 & 0x3F00) | (cp & 0x3F) << 16;
+            out[0] = static_cast<Och>(chs);
+            out[1] = static_cast<Och>(chs >> 8);
+            out[2] = static_cast<Och>(chs >> 16);
+            oit = out + 3;
+            return;
+        }
+        if (cp < 0x200000) // 1111_0xxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
+        {
+            uint32_t const chs = 0x808080F0 | cp >> 18 | (cp >> 4 & 0x3F00) | (cp << 10 & 0x3F0000) | (cp & 0x3F) << 24;
+            out[0] = static_cast<Och>(chs);
+            out[1] = static_cast<Och>(chs >> 8);
+            out[2] = static_cast<Och>(chs >> 16);
+            out[3] = static_cast<Och>(chs >> 24);
+            oit = out + 4;
+            return;
+        }
+        // 1111_10xx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
+        // 1111_110x 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx 10xx_xxxx
+        size_t const size = cp < 0x4000000 ? 5 : 6;
+        out[0] = static_cast<Och>((size == 5 ? 0xF8 : 0xFC) | cp >> 6 * (size - 1));
+        for (size_t n = 1; n < size; ++n)
+            out[n] = static_cast<Och>(0x80 | (cp >> 6 * (size - 1 - n) & 0x3F));
+        oit = out + size;
+    }
+
+private:
+    template<typename ReadFn>
+    static WW898_UTF_CONSTEXPR14 char_type read_slave(ReadFn & read_fn)
+    {
+        char_type const ch = read_fn();
+        if (ch >> 6 != 2)
+            throw std::runtime_error("The utf8 slave char in sequence is incorrect");
+        return ch;
     }
 };
 
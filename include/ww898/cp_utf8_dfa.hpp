@@ -0,0 +1,217 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/cp_utf8.hpp>
+#include <ww898/utf_errors.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+// The automaton accepts exactly the same sequences as `utf8`. The class of the byte is the number of its leading one
+// bits. Every state is the bit offset of the 6-bit next state in the row of the class, so the next state is found by
+// the shift of the row, which depends on the byte only, and the critical path is not longer than one shift per byte.
+// The top byte of the row masks the payload bits of the byte. Both tables take 320 bytes.
+template<typename T = void>
+struct utf8_dfa_tables final
+{
+    static uint32_t const accept = 0;
+    static uint32_t const reject = 6;
+
+    static constexpr uint8_t classes[256] =
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x30
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x40
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x50
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x60
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x70
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x80
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x90
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0xA0
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0xB0
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xC0
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xD0
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0xE0
+        4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 7, 7, // 0xF0
+    };
+
+    // The states are accept (0), reject (6) and 1‥5 slave bytes left (12‥36)
+    static constexpr uint64_t rows[8] =
+    {
+        UINT64_C(0x7F00006186186180), // 0xxx_xxxx
+        UINT64_C(0x3F0001E612300186), // 10xx_xxxx
+        UINT64_C(0x1F0000618618618C), // 110x_xxxx
+        UINT64_C(0x0F00006186186192), // 1110_xxxx
+        UINT64_C(0x0700006186186198), // 1111_0xxx
+        UINT64_C(0x030000618618619E), // 1111_10xx
+        UINT64_C(0x01000061861861A4), // 1111_110x
+        UINT64_C(0x0000006186186186), // 1111_111x
+    };
+
+    static WW898_UTF_CONSTEXPR14 uint64_t row(uint8_t const ch) throw()
+    {
+        return rows[classes[ch]];
+    }
+
+    static WW898_UTF_CONSTEXPR14 uint32_t next(uint64_t const row, uint32_t const state) throw()
+    {
+        return static_cast<uint32_t>(row >> state) & 0x3F;
+    }
+
+    static WW898_UTF_CONSTEXPR14 uint32_t payload(uint64_t const row, uint8_t const ch) throw()
+    {
+        return ch & static_cast<uint32_t>(row >> 56);
+    }
+};
+
+template<typename T> uint32_t const utf8_dfa_tables<T>::accept;
+template<typename T> uint32_t const utf8_dfa_tables<T>::reject;
+template<typename T> constexpr uint8_t utf8_dfa_tables<T>::classes[256];
+template<typename T> constexpr uint64_t utf8_dfa_tables<T>::rows[8];
+
+}
+
+// The table driven UTF-8 decoder in the style of Bjoern Hoehrmann's one. It accepts and writes exactly the same
+// sequences as `utf8`, but every byte costs the same table lookups and shift regardless of the symbol length, so the mixed
+// length input does not mispredict the length tests. The contiguous input is decoded by `utf8_dfa_decode` with no
+// branches on the symbol boundaries at all.
+struct utf8_dfa final
+{
+    static size_t const max_unicode_symbol_size = utf8::max_unicode_symbol_size;
+    static size_t const max_supported_symbol_size = utf8::max_supported_symbol_size;
+
+    static uint32_t const max_supported_code_point = utf8::max_supported_code_point;
+
+    using char_type = utf8::char_type;
+
+    template<typename PeekFn>
+    static WW898_UTF_CONSTEXPR14 size_t char_size(PeekFn && peek_fn)
+    {
+        using tables = detail::utf8_dfa_tables<>;
+        char_type const ch0 = std::forward<PeekFn>(peek_fn)();
+        uint32_t const state = tables::next(tables::row(ch0), tables::accept);
+        if (state == tables::reject)
+            throw std::runtime_error("The utf8 first char in sequence is incorrect");
+        return state ? state / 6 : 1;
+    }
+
+    template<typename ReadFn>
+    static WW898_UTF_CONSTEXPR14 uint32_t read(ReadFn && read_fn)
+    {
+        using tables = detail::utf8_dfa_tables<>;
+        uint32_t cp = 0;
+        uint32_t state = tables::accept;
+        do
+        {
+            char_type const ch = read_fn();
+            auto const row = tables::row(ch);
+            uint32_t const next = tables::next(row, state);
+            if (next == tables::reject)
+                throw std::runtime_error(state == tables::accept
+                    ? "The utf8 first char in sequence is incorrect"
+                    : "The utf8 slave char in sequence is incorrect");
+            cp = cp << 6 | tables::payload(row, ch);
+            state = next;
+        }
+        while (state != tables::accept);
+        return cp;
+    }
+
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn && read_back_fn)
+    {
+        return utf8::char_size_back(std::forward<ReadBackFn>(read_back_fn));
+    }
+
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        return utf8::read_back(std::forward<ReadBackFn>(read_back_fn));
+    }
+
+    // Decodes the symbol without exceptions. On error `it` is left after the lead char and the correct slave chars, so
+    // the next symbol starts from the first incorrect char.
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const & eit, uint32_t & cp)
+    {
+        using tables = detail::utf8_dfa_tables<>;
+        char_type ch = *it++;
+        auto row = tables::row(ch);
+        uint32_t state = tables::next(row, tables::accept);
+        if (state == tables::reject)
+            return utf_error::invalid_lead;
+        uint32_t res = tables::payload(row, ch);
+        while (state != tables::accept)
+        {
+            if (it == eit)
+                return utf_error::not_enough_input;
+            ch = *it;
+            row = tables::row(ch);
+            state = tables::next(row, state);
+            if (state == tables::reject)
+                return utf_error::invalid_slave;
+            ++it;
+            res = res << 6 | tables::payload(row, ch);
+        }
+        cp = res;
+        return utf_error::none;
+    }
+
+    static WW898_UTF_CONSTEXPR14 bool encodable(uint32_t const cp) throw()
+    {
+        return utf8::encodable(cp);
+    }
+
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void encode(uint32_t const cp, WriteFn && write_fn)
+    {
+        utf8::encode(cp, std::forward<WriteFn>(write_fn));
+    }
+
+    template<typename WriteFn>
+    static WW898_UTF_CONSTEXPR14 void write(uint32_t const cp, WriteFn && write_fn)
+    {
+        utf8::write(cp, std::forward<WriteFn>(write_fn));
+    }
+
+    template<typename Och>
+    static void write_block(uint32_t const cp, Och * & oit) throw()
+    {
+        utf8::write_block(cp, oit);
+    }
+};
+
+}}
@@ -0,0 +1,264 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/cp_utf16.hpp>
+#include <ww898/cp_utf32.hpp>
+#include <ww898/utf_errors.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+template<size_t Size>
+struct byte_swap final {};
+
+template<>
+struct byte_swap<2> final
+{
+    using type = uint16_t;
+
+    static uint16_t apply(uint16_t const ch) throw()
+    {
+        return static_cast<uint16_t>(ch << 8 | ch >> 8);
+    }
+};
+
+template<>
+struct byte_swap<4> final
+{
+    using type = uint32_t;
+
+    static uint32_t apply(uint32_t const ch) throw()
+    {
+        return ch << 24 | (ch & 0xFF00) << 8 | (ch >> 8 & 0xFF00) | ch >> 24;
+    }
+};
+
+template<typename Eit>
+struct swapped_end final
+{
+    Eit const & eit;
+};
+
+// Feeds the units of the foreign byte order to `decode` of the native codec
+template<
+    typename It,
+    typename Ch>
+class swapped_input final
+{
+public:
+    struct value final
+    {
+        Ch ch;
+
+        Ch operator*() const throw() { return ch; }
+    };
+
+    explicit swapped_input(It & it) throw() : it_(it) {}
+
+    Ch operator*() const { return byte_swap<sizeof(Ch)>::apply(static_cast<Ch>(*it_)); }
+
+    swapped_input & operator++() { ++it_; return *this; }
+
+    value operator++(int) { value const res = {**this}; ++it_; return res; }
+
+    template<typename Eit>
+    bool operator==(swapped_end<Eit> const & end) const { return it_ == end.eit; }
+
+    template<typename Eit>
+    bool operator!=(swapped_end<Eit> const & end) const { return !(it_ == end.eit); }
+
+private:
+    It & it_;
+};
+
+}
+
+// The codec of the byte swapped units of `Utf`, e.g. UTF-16BE on the little-endian platform. The input and output
+// units are the raw 16/32-bit units of the foreign byte order, all the other contracts are the same as for `Utf`.
+template<typename Utf>
+struct utf_swapped final
+{
+    static size_t const max_unicode_symbol_size = Utf::max_unicode_symbol_size;
+    static size_t const max_supported_symbol_size = Utf::max_supported_symbol_size;
+
+    static uint32_t const max_supported_code_point = Utf::max_supported_code_point;
+
+    using char_type = typename Utf::char_type;
+
+    using native_type = Utf;
+
+    static char_type swap(char_type const ch) throw()
+    {
+        return detail::byte_swap<sizeof(char_type)>::apply(ch);
+    }
+
+    template<typename PeekFn>
+    static size_t char_size(PeekFn && peek_fn)
+    {
+        return Utf::char_size([&peek_fn] { return swap(peek_fn()); });
+    }
+
+    template<typename ReadFn>
+    static uint32_t read(ReadFn && read_fn)
+    {
+        return Utf::read([&read_fn] { return swap(read_fn()); });
+    }
+
+    template<typename ReadBackFn>
+    static size_t char_size_back(ReadBackFn && read_back_fn)
+    {
+        return Utf::char_size_back([&read_back_fn] { return swap(read_back_fn()); });
+    }
+
+    template<typename ReadBackFn>
+    static uint32_t read_back(ReadBackFn && read_back_fn)
+    {
+        return Utf::read_back([&read_back_fn] { return swap(read_back_fn()); });
+    }
+
+    template<
+        typename It,
+        typename Eit>
+    static utf_error decode(It & it, Eit const & eit, uint32_t & cp)
+    {
+        detail::swapped_input<It, char_type> input(it);
+        return Utf::decode(input, detail::swapped_end<Eit>{eit}, cp);
+    }
+
+    static bool encodable(uint32_t const cp) throw()
+    {
+        return Utf::encodable(cp);
+    }
+
+    template<typename WriteFn>
+    static void encode(uint32_t const cp, WriteFn && write_fn)
+    {
+        Utf::encode(cp, [&write_fn] (char_type const ch) { write_fn(swap(ch)); });
+    }
+
+    template<typename WriteFn>
+    static void write(uint32_t const cp, WriteFn && write_fn)
+    {
+        Utf::write(cp, [&write_fn] (char_type const ch) { write_fn(swap(ch)); });
+    }
+};
+
+// Reads the `Ch` units stored in the raw bytes, e.g. the UTF-16BE text at the odd offset of the feed buffer. Every
+// unit is loaded with `memcpy`, so the bytes may have any alignment and are never accessed through the unit type.
+template<typename Ch>
+class byte_unit_iterator final
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Ch;
+    using difference_type = ptrdiff_t;
+    using pointer = Ch const *;
+    using reference = Ch;
+
+    byte_unit_iterator() throw() : it_(nullptr) {}
+
+    explicit byte_unit_iterator(void const * const it) throw() : it_(static_cast<unsigned char const *>(it)) {}
+
+    // The position of the current unit in the bytes
+    unsigned char const * base() const throw() { return it_; }
+
+    Ch operator*() const throw()
+    {
+        Ch ch;
+        std::memcpy(&ch, it_, sizeof(Ch));
+        return ch;
+    }
+
+    Ch operator[](difference_type const n) const throw() { return *(*this + n); }
+
+    byte_unit_iterator & operator++() throw() { it_ += sizeof(Ch); return *this; }
+    byte_unit_iterator & operator--() throw() { it_ -= sizeof(Ch); return *this; }
+
+    byte_unit_iterator operator++(int) throw() { auto const res = *this; it_ += sizeof(Ch); return res; }
+    byte_unit_iterator operator--(int) throw() { auto const res = *this; it_ -= sizeof(Ch); return res; }
+
+    byte_unit_iterator & operator+=(difference_type const n) throw()
+    {
+        it_ += n * static_cast<difference_type>(sizeof(Ch));
+        return *this;
+    }
+
+    byte_unit_iterator & operator-=(difference_type const n) throw()
+    {
+        it_ -= n * static_cast<difference_type>(sizeof(Ch));
+        return *this;
+    }
+
+    byte_unit_iterator operator+(difference_type const n) const throw() { auto res = *this; return res += n; }
+    byte_unit_iterator operator-(difference_type const n) const throw() { auto res = *this; return res -= n; }
+
+    friend byte_unit_iterator operator+(difference_type const n, byte_unit_iterator const & it) throw()
+    {
+        return it + n;
+    }
+
+    difference_type operator-(byte_unit_iterator const & other) const throw()
+    {
+        return (it_ - other.it_) / static_cast<difference_type>(sizeof(Ch));
+    }
+
+    bool operator==(byte_unit_iterator const & other) const throw() { return it_ == other.it_; }
+    bool operator!=(byte_unit_iterator const & other) const throw() { return it_ != other.it_; }
+    bool operator< (byte_unit_iterator const & other) const throw() { return it_ <  other.it_; }
+    bool operator> (byte_unit_iterator const & other) const throw() { return it_ >  other.it_; }
+    bool operator<=(byte_unit_iterator const & other) const throw() { return it_ <= other.it_; }
+    bool operator>=(byte_unit_iterator const & other) const throw() { return it_ >= other.it_; }
+
+private:
+    unsigned char const * it_;
+};
+
+#if defined(_WIN32) || defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+using utf16le = utf16;
+using utf16be = utf_swapped<utf16>;
+using utf32le = utf32;
+using utf32be = utf_swapped<utf32>;
+
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+
+using utf16le = utf_swapped<utf16>;
+using utf16be = utf16;
+using utf32le = utf_swapped<utf32>;
+using utf32be = utf32;
+
+#else
+#error Unsupported byte order
+#endif
+
+}}
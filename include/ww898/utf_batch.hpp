@@ -0,0 +1,182 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_converters.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+// All the values are converted into the room of `size` units, the output offsets are the running sum of the converted
+// sizes. `next_fn(it, eit)` returns the next input value.
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Ch,
+    typename Data,
+    typename Offsets,
+    typename NextFn>
+void batch_conv_room(size_t const count, size_t const size, NextFn && next_fn, Data & res_data, Offsets & res_offsets)
+{
+    using och_type = typename Data::value_type;
+    using offset_type = typename Offsets::value_type;
+
+    auto const offsets = &res_offsets[0];
+    append_overwrite(res_data, size, [count, &next_fn, offsets] (och_type * const first)
+        {
+            auto oit = first;
+            offsets[0] = 0;
+            for (size_t n = 0; n < count; ++n)
+            {
+                Ch const * it;
+                Ch const * eit;
+                next_fn(it, eit);
+                oit = room_conv_selector<Utf, Outf, Policy, Ch, och_type>::apply(it, eit, oit);
+                offsets[n + 1] = static_cast<offset_type>(oit - first);
+            }
+#if defined(WW898_UTF_EXCEPTIONS)
+            if (static_cast<size_t>(oit - first) > static_cast<size_t>(std::numeric_limits<offset_type>::max()))
+                throw std::length_error("Too large output for the offset type");
+#endif
+            return oit;
+        });
+}
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Ch,
+    typename Data,
+    typename Offsets,
+    typename NextFn>
+void batch_conv_values(size_t const count, size_t const total_size, NextFn && next_fn, Data & res_data, Offsets & res_offsets)
+{
+    using och_type = typename Data::value_type;
+    static_assert(sizeof(och_type) == sizeof(typename Outf::char_type), "The container can not hold the output units");
+    static_assert(!std::is_same<Policy, error_stop>::value, "The batch can not stop in the middle");
+
+    auto const size = room_size<Utf, Outf, Policy>(total_size);
+    res_data.clear();
+#if defined(WW898_UTF_EXCEPTIONS)
+    res_offsets.resize(count + 1);
+    try
+    {
+        batch_conv_room<Utf, Outf, Policy, Ch>(count, size, next_fn, res_data, res_offsets);
+    }
+    catch (...)
+    {
+        res_offsets.clear();
+        throw;
+    }
+#else
+    // The overflow can not be reported after the conversion, so the worst case size is checked up front
+    if (size > static_cast<size_t>(std::numeric_limits<typename Offsets::value_type>::max()))
+    {
+        res_offsets.clear();
+        return;
+    }
+    res_offsets.resize(count + 1);
+    batch_conv_room<Utf, Outf, Policy, Ch>(count, size, next_fn, res_data, res_offsets);
+#endif
+}
+
+}
+
+// Converts the values stored in the Arrow-style layout: the value `n` is `[data + offsets[n]‥data + offsets[n + 1])`.
+// The converted values replace the content of `res_data` and their `count + 1` offsets replace the content of
+// `res_offsets`, so the converted value `n` is `[res_offsets[n]‥res_offsets[n + 1])` of `res_data`. The output grows once
+// to the worst case size of the whole batch and every value is converted by the bulk kernels right into its place.
+// With `error_throw` the first malformed value throws the same error as `conv` and both outputs are left empty.
+// Without the exceptions the batch whose worst case size does not fit the offset type leaves both outputs empty.
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy = error_throw,
+    typename Ch,
+    typename Offset,
+    typename Data,
+    typename Offsets,
+    typename std::enable_if<is_error_policy<Policy>::value, void *>::type = nullptr>
+void batch_conv(
+    Ch const * const data,
+    Offset const * const offsets,
+    size_t const count,
+    Data & res_data,
+    Offsets & res_offsets)
+{
+    auto const total_size = count ? static_cast<size_t>(offsets[count] - offsets[0]) : 0;
+    auto offset_it = offsets;
+    detail::batch_conv_values<Utf, Outf, Policy, Ch>(count, total_size,
+        [data, offset_it] (Ch const * & it, Ch const * & eit) mutable
+        {
+            it = data + *offset_it;
+            eit = data + *++offset_it;
+        },
+        res_data, res_offsets);
+}
+
+// Converts the range of the strings or the string views, the codecs are selected by the char types
+template<
+    typename Policy = error_throw,
+    typename It,
+    typename Data,
+    typename Offsets,
+    typename std::enable_if<is_error_policy<Policy>::value, void *>::type = nullptr>
+void batch_conv(
+    It const first,
+    It const last,
+    Data & res_data,
+    Offsets & res_offsets)
+{
+    using ch_type = typename std::iterator_traits<It>::value_type::value_type;
+    size_t count = 0;
+    size_t total_size = 0;
+    for (auto it = first; it != last; ++it, ++count)
+        total_size += it->size();
+    auto value_it = first;
+    detail::batch_conv_values<utf_selector_t<ch_type>, utf_selector_t<typename Data::value_type>, Policy, ch_type>(count, total_size,
+        [value_it] (ch_type const * & it, ch_type const * & eit) mutable
+        {
+            it = value_it->data();
+            eit = it + value_it->size();
+            ++value_it;
+        },
+        res_data, res_offsets);
+}
+
+}}
@@ -37,6 +37,43 @@
 #endif
 #endif
 
+// Define `WW898_UTF_NO_SIMD` to build the library with the scalar code only
+#if !defined(WW898_UTF_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2
+#define WW898_UTF_SSE2
+#endif
+#endif
+
+// The AVX2 and AVX-512 kernels are compiled regardless of the compiler options and selected at runtime
+#if defined(WW898_UTF_SSE2) && (defined(__clang__) || defined(__GNUC__) && __GNUC__ >= 5 || defined(_MSC_VER) && _MSC_VER >= 1800)
+#define WW898_UTF_AVX2
+#endif
+#if defined(WW898_UTF_AVX2) && (defined(__clang__) || defined(__GNUC__) || defined(_MSC_VER) && _MSC_VER >= 1910)
+#define WW898_UTF_AVX512
+#endif
+
+#if defined(__GNUC__)
+#define WW898_UTF_TARGET(features) __attribute__((target(features)))
+#else
+#define WW898_UTF_TARGET(features)
+#endif
+#define WW898_UTF_TARGET_AVX2 WW898_UTF_TARGET("avx2")
+#define WW898_UTF_TARGET_AVX512 WW898_UTF_TARGET("avx512f,avx512bw")
+
+// The codec functions are usable in the constant expressions since C++14, the throwing branch of the invalid input
+// turns into the compile error
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304 || defined(_MSVC_LANG) && _MSVC_LANG >= 201402 && _MSC_VER >= 1910
+#define WW898_UTF_CONSTEXPR14 constexpr
+#define WW898_UTF_HAS_CONSTEXPR14
+#else
+#define WW898_UTF_CONSTEXPR14
+#endif
+
+// Only the non-throwing error policies are usable when the exceptions are disabled, e.g. by `-fno-exceptions`
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define WW898_UTF_EXCEPTIONS
+#endif
+
 namespace ww898 {
 namespace utf {
 static uint32_t const max_unicode_code_point = 0x10FFFF;
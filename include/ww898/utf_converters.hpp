@@ -25,14 +25,21 @@
 #pragma once
 
 #include <ww898/utf_selector.hpp>
+#include <ww898/utf_simd.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_validate.hpp>
+#include <ww898/utf_errors.hpp>
 #include <ww898/utf_config.hpp>
 
 #include <cstdint>
+#include <algorithm>
 #include <stdexcept>
 #include <utility>
 #include <type_traits>
 #include <iterator>
 #include <string>
+#include <memory>
+#include <exception>
 
 #if __cpp_lib_string_view >= 201606
 #include <string_view>
@@ -88,26 +95,297 @@ struct convz_strategy<Utf, Outf, It, Oit, convz_impl::binary_copy>
 
 }
 
+namespace detail {
+
+enum struct conv_impl { normal, random_interator, contiguous, contiguous_room, binary_copy };
+
 template<
-    typename Utf,
     typename Outf,
+    typename Oit>
+struct is_contiguous_output final : std::integral_constant<bool,
+    std::is_pointer<Oit>::value &&
+    std::is_integral<typename std::remove_pointer<Oit>::type>::value &&
+    !std::is_const<typename std::remove_pointer<Oit>::type>::value &&
+    sizeof(typename std::remove_pointer<Oit>::type) == sizeof(typename Outf::char_type)> {};
+
+template<typename Alloc>
+struct is_allocator final
+{
+    template<typename T>
+    static std::true_type test(decltype(std::declval<T &>().allocate(size_t())) *);
+
+    template<typename T>
+    static std::false_type test(...);
+
+    static bool const value = decltype(test<Alloc>(nullptr))::value;
+};
+
+// The codec may provide `read_block` and `write_block` which work on the contiguous spans instead of the per-unit
+// functors, so they are free to load and store several units at once
+template<typename Utf>
+struct has_read_block final
+{
+    template<typename T>
+    static std::true_type test(decltype(T::read_block(std::declval<typename T::char_type const * &>())) *);
+
+    template<typename T>
+    static std::false_type test(...);
+
+    static bool const value = decltype(test<Utf>(nullptr))::value;
+};
+
+template<typename Utf>
+struct has_write_block final
+{
+    template<typename T>
+    static std::true_type test(decltype(T::write_block(uint32_t(), std::declval<typename T::char_type * &>())) *);
+
+    template<typename T>
+    static std::false_type test(...);
+
+    static bool const value = decltype(test<Utf>(nullptr))::value;
+};
+
+// Reads the symbol which has at least `Utf::max_supported_symbol_size` units after its start
+template<
+    typename Utf,
     typename It,
+    bool = is_contiguous_input<Utf, It>::value && has_read_block<Utf>::value>
+struct symbol_reader final
+{
+    static uint32_t read(It & it)
+    {
+        return Utf::read([&it] { return *it++; });
+    }
+};
+
+template<
+    typename Utf,
+    typename It>
+struct symbol_reader<Utf, It, true> final
+{
+    static uint32_t read(It & it)
+    {
+        return Utf::read_block(it);
+    }
+};
+
+template<
+    typename Outf,
+    typename Oit,
+    bool = is_contiguous_output<Outf, Oit>::value && has_write_block<Outf>::value>
+struct symbol_writer final
+{
+    static void write(uint32_t const cp, Oit & oit)
+    {
+        Outf::write(cp, [&oit] (typename Outf::char_type const ch) { *oit++ = ch; });
+    }
+
+    // The code point is `encodable`
+    static void encode(uint32_t const cp, Oit & oit)
+    {
+        Outf::encode(cp, [&oit] (typename Outf::char_type const ch) { *oit++ = ch; });
+    }
+};
+
+template<
+    typename Outf,
     typename Oit>
-Oit convz(It && it, Oit && oit)
+struct symbol_writer<Outf, Oit, true> final
 {
-    return detail::convz_strategy<Utf, Outf,
-            typename std::decay<It>::type,
-            typename std::decay<Oit>::type,
-            std::is_same<Utf, Outf>::value
-                ? detail::convz_impl::binary_copy
-                : detail::convz_impl::normal>()(
-        std::forward<It>(it),
-        std::forward<Oit>(oit));
-}
+    static void write(uint32_t const cp, Oit & oit)
+    {
+        if (!Outf::encodable(cp))
+            Outf::write(cp, [] (typename Outf::char_type) {}); // Throws the error of the codec
+        Outf::write_block(cp, oit);
+    }
 
-namespace detail {
+    static void encode(uint32_t const cp, Oit & oit)
+    {
+        Outf::write_block(cp, oit);
+    }
+};
+
+// Converts one symbol of the contiguous input
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Oit,
+    bool valid>
+struct symbol_conv final
+{
+    // At least `Utf::max_supported_symbol_size` units are left
+    static void apply(Ch const * & it, Oit & oit)
+    {
+        symbol_writer<Outf, Oit>::write(symbol_reader<Utf, Ch const *>::read(it), oit);
+    }
+
+    static void apply_tail(Ch const * & it, Ch const * const eit, Oit & oit)
+    {
+        auto const read_fn = [&it, &eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            };
+        symbol_writer<Outf, Oit>::write(Utf::read(read_fn), oit);
+    }
+};
+
+// The input is checked by the validator, so the symbol is decoded and encoded without exceptions
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Oit>
+struct symbol_conv<Utf, Outf, Ch, Oit, true> final
+{
+    static void apply(Ch const * & it, Oit & oit)
+    {
+        apply_tail(it, it + Utf::max_supported_symbol_size, oit);
+    }
+
+    static void apply_tail(Ch const * & it, Ch const * const eit, Oit & oit)
+    {
+        uint32_t cp = 0;
+        Utf::decode(it, eit, cp);
+        symbol_writer<Outf, Oit>::encode(cp, oit);
+    }
+};
+
+enum struct block_output_impl { normal, back_insert, contiguous };
+
+template<typename Oit>
+struct back_insert_container final {};
+
+template<typename Container>
+struct back_insert_container<std::back_insert_iterator<Container>> final
+{
+    using type = Container;
+
+    // Note: The container pointer is the protected member of `std::back_insert_iterator`, so it is available only
+    //       through the derived class.
+    struct accessor final : std::back_insert_iterator<Container>
+    {
+        static Container & get(std::back_insert_iterator<Container> & oit) throw()
+        {
+            return *(oit.*&accessor::container);
+        }
+    };
+};
+
+template<
+    typename Oit,
+    block_output_impl>
+struct block_append final
+{
+    template<typename Och>
+    static void apply(Oit & oit, Och const * const buf, Och const * const ebuf)
+    {
+        oit = std::copy(buf, ebuf, oit);
+    }
+};
+
+template<typename Oit>
+struct block_append<Oit, block_output_impl::back_insert> final
+{
+    template<typename Och>
+    static void apply(Oit & oit, Och const * const buf, Och const * const ebuf)
+    {
+        auto & container = back_insert_container<Oit>::accessor::get(oit);
+        container.insert(container.end(), buf, ebuf);
+    }
+};
+
+template<
+    typename Outf,
+    typename Oit,
+    block_output_impl>
+struct block_buffer_char final
+{
+    using type = typename Outf::char_type;
+};
+
+// Note: `std::basic_string::insert` copies the chars of the other type to the temporary string first, so the buffer
+//       holds the chars of the container.
+template<
+    typename Outf,
+    typename Oit>
+struct block_buffer_char<Outf, Oit, block_output_impl::back_insert> final
+{
+    using value_type = typename back_insert_container<Oit>::type::value_type;
+    using type = typename std::conditional<
+        std::is_integral<value_type>::value && sizeof(value_type) == sizeof(typename Outf::char_type),
+        value_type,
+        typename Outf::char_type>::type;
+};
+
+// The kernel is selected once per conversion
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Oit,
+    block_output_impl impl>
+struct block_conv_writer final
+{
+    static size_t const buffer_size = 1024;
+
+    using och_type = typename block_buffer_char<Outf, Oit, impl>::type;
+    using kernel_type = block_kernel<Ch, och_type>;
+
+    kernel_type const kernel = block_conv<Utf, Outf>::template kernel<Ch, och_type>();
+
+    void operator()(Ch const * & it, Ch const * eit, Oit & oit) const
+    {
+        och_type buf[buffer_size + block_conv<Utf, Outf>::overrun];
+        if (static_cast<size_t>(eit - it) > buffer_size / block_conv<Utf, Outf>::max_ratio)
+            eit = it + buffer_size / block_conv<Utf, Outf>::max_ratio;
+        auto ebuf = buf;
+        kernel(it, eit, ebuf);
+        block_append<Oit, impl>::apply(oit, buf, ebuf);
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Oit>
+struct block_conv_writer<Utf, Outf, Ch, Oit, block_output_impl::contiguous> final
+{
+    using och_type = typename std::remove_pointer<Oit>::type;
+    using kernel_type = block_kernel<Ch, och_type>;
 
-enum struct conv_impl { normal, random_interator, binary_copy };
+    kernel_type const kernel = block_conv<Utf, Outf>::template kernel<Ch, och_type>();
+
+    void operator()(Ch const * & it, Ch const * const eit, Oit & oit) const
+    {
+        kernel(it, eit, oit);
+    }
+};
+
+// The kernel writes straight to the contiguous output only if it never writes past the converted symbols
+template<
+    typename Utf,
+    typename Outf,
+    typename Oit>
+struct block_output_selector final
+{
+    template<typename T>
+    static std::true_type test(typename back_insert_container<T>::type *);
+
+    template<typename T>
+    static std::false_type test(...);
+
+    static block_output_impl const value =
+        is_contiguous_output<Outf, Oit>::value && block_conv<Utf, Outf>::overrun == 0
+            ? block_output_impl::contiguous
+            : decltype(test<Oit>(nullptr))::value
+                ? block_output_impl::back_insert
+                : block_output_impl::normal;
+};
 
 template<
     typename Utf,
@@ -125,9 +403,8 @@ struct conv_strategy final
                     throw std::runtime_error("Not enough input");
                 return *it++;
             };
-        auto const write_fn = [&oit] (typename Outf::char_type const ch) { *oit++ = ch; };
         while (it != eit)
-            Outf::write(Utf::read(read_fn), write_fn);
+            symbol_writer<Outf, Oit>::write(Utf::read(read_fn), oit);
         return oit;
     }
 };
@@ -141,13 +418,11 @@ struct conv_strategy<Utf, Outf, It, Oit, conv_impl::random_interator> final
 {
     Oit operator()(It it, It const eit, Oit oit) const
     {
-        auto const write_fn = [&oit] (typename Outf::char_type const ch) { *oit++ = ch; };
         if (eit - it >= static_cast<typename std::iterator_traits<It>::difference_type>(Utf::max_supported_symbol_size))
         {
-            auto const fast_read_fn = [&it] { return *it++; };
             auto const fast_eit = eit - Utf::max_supported_symbol_size;
             while (it < fast_eit)
-                Outf::write(Utf::read(fast_read_fn), write_fn);
+                symbol_writer<Outf, Oit>::write(symbol_reader<Utf, It>::read(it), oit);
         }
         auto const read_fn = [&it, &eit]
             {
@@ -156,11 +431,61 @@ struct conv_strategy<Utf, Outf, It, Oit, conv_impl::random_interator> final
                 return *it++;
             };
         while (it != eit)
-            Outf::write(Utf::read(read_fn), write_fn);
+            symbol_writer<Outf, Oit>::write(Utf::read(read_fn), oit);
+        return oit;
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit,
+    block_output_impl output,
+    bool valid = false>
+struct contiguous_conv_strategy
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+    using symbol = symbol_conv<Utf, Outf, char_type, Oit, valid>;
+
+    Oit operator()(char_type const * it, char_type const * const eit, Oit oit) const
+    {
+        if (static_cast<size_t>(eit - it) >= Utf::max_supported_symbol_size)
+        {
+            block_conv_writer<Utf, Outf, char_type, Oit, output> block_write;
+            auto const fast_eit = eit - Utf::max_supported_symbol_size;
+            while (it < fast_eit)
+                if (block_conv<Utf, Outf>::accepts(it))
+                    block_write(it, eit, oit);
+                else
+                    symbol::apply(it, oit);
+        }
+        while (it != eit)
+            symbol::apply_tail(it, eit, oit);
         return oit;
     }
 };
 
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+struct conv_strategy<Utf, Outf, It, Oit, conv_impl::contiguous> final
+    : contiguous_conv_strategy<Utf, Outf, It, Oit, block_output_selector<Utf, Outf, Oit>::value> {};
+
+// The contiguous output has the room for the kernel overrun, so the kernel always writes straight to it
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+struct conv_strategy<Utf, Outf, It, Oit, conv_impl::contiguous_room> final
+    : contiguous_conv_strategy<Utf, Outf, It, Oit,
+        is_contiguous_output<Outf, Oit>::value
+            ? block_output_impl::contiguous
+            : block_output_selector<Utf, Outf, Oit>::value> {};
+
 template<
     typename Utf,
     typename Outf,
@@ -176,77 +501,852 @@ struct conv_strategy<Utf, Outf, It, Oit, conv_impl::binary_copy> final
     }
 };
 
-}
+// Converts the contiguous input checked by the validator, nothing throws
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Oit,
+    conv_impl = std::is_same<Utf, Outf>::value
+        ? conv_impl::binary_copy
+        : block_conv<Utf, Outf>::enabled
+            ? conv_impl::contiguous
+            : conv_impl::normal>
+struct valid_conv_strategy final
+{
+    Oit operator()(Ch const * it, Ch const * const eit, Oit oit) const
+    {
+        while (it != eit)
+            symbol_conv<Utf, Outf, Ch, Oit, true>::apply_tail(it, eit, oit);
+        return oit;
+    }
+};
 
 template<
     typename Utf,
     typename Outf,
-    typename It,
-    typename Eit,
+    typename Ch,
     typename Oit>
-Oit conv(It && it, Eit && eit, Oit && oit)
-{
-    return detail::conv_strategy<Utf, Outf,
-            typename std::decay<It>::type,
-            typename std::decay<Oit>::type,
-            std::is_same<Utf, Outf>::value
-                ? detail::conv_impl::binary_copy
-                : std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<typename std::decay<It>::type>::iterator_category>::value
-                    ? detail::conv_impl::random_interator
-                    : detail::conv_impl::normal>()(
-        std::forward<It>(it),
-        std::forward<Eit>(eit),
-        std::forward<Oit>(oit));
-}
+struct valid_conv_strategy<Utf, Outf, Ch, Oit, conv_impl::contiguous> final
+    : contiguous_conv_strategy<Utf, Outf, Ch const *, Oit, block_output_selector<Utf, Outf, Oit>::value, true> {};
 
 template<
+    typename Utf,
     typename Outf,
     typename Ch,
     typename Oit>
-Oit convz(Ch const * const str, Oit && oit)
+struct valid_conv_strategy<Utf, Outf, Ch, Oit, conv_impl::binary_copy> final
 {
-    return convz<utf_selector_t<Ch>, Outf>(str, std::forward<Oit>(oit));
-}
+    Oit operator()(Ch const * const it, Ch const * const eit, Oit const oit) const
+    {
+        return std::copy(it, eit, oit);
+    }
+};
 
 template<
-    typename Och,
-    typename Str>
-std::basic_string<Och> convz(Str && str)
+    typename Policy,
+    typename It,
+    typename Oit>
+struct conv_result_selector final
 {
-    std::basic_string<Och> res;
-    convz<utf_selector_t<Och>>(std::forward<Str>(str), std::back_inserter(res));
-    return res;
-}
+    using type = Oit;
+
+    static type make(It const &, Oit oit, utf_error) { return oit; }
+};
+
+template<
+    typename It,
+    typename Oit>
+struct conv_result_selector<error_stop, It, Oit> final
+{
+    using type = conv_status<It, Oit>;
+
+    static type make(It it, Oit oit, utf_error const error) { return {it, oit, error}; }
+};
 
 template<
+    typename Utf,
     typename Outf,
-    typename Ch,
+    typename Policy,
+    typename It,
     typename Oit>
-Oit conv(std::basic_string<Ch> const & str, Oit && oit)
+struct conv_selector final
 {
-    return conv<utf_selector_t<Ch>, Outf>(str.cbegin(), str.cend(), std::forward<Oit>(oit));
-}
+    static typename conv_result_selector<Policy, It, Oit>::type apply(It it, It eit, Oit oit);
+};
 
-#if __cpp_lib_string_view >= 201606
 template<
+    typename Utf,
     typename Outf,
-    typename Ch,
+    typename It,
     typename Oit>
-Oit conv(std::basic_string_view<Ch> const & str, Oit && oit)
+struct conv_selector<Utf, Outf, error_throw, It, Oit> final
 {
-    return conv<utf_selector_t<Ch>, Outf>(str.cbegin(), str.cend(), std::forward<Oit>(oit));
+    static Oit apply(It it, It const eit, Oit oit)
+    {
+        return conv_strategy<Utf, Outf, It, Oit,
+                std::is_same<Utf, Outf>::value
+                    ? conv_impl::binary_copy
+                    : block_conv<Utf, Outf>::enabled && is_contiguous_input<Utf, It>::value
+                        ? conv_impl::contiguous
+                    : std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value
+                        ? conv_impl::random_interator
+                        : conv_impl::normal>()(it, eit, oit);
+    }
+};
+
 }
-#endif
 
 template<
-    typename Och,
-    typename Str,
-    typename std::enable_if<!std::is_same<typename std::decay<Str>::type, std::basic_string<Och>>::value, void *>::type = nullptr>
-std::basic_string<Och> conv(Str && str)
+    typename Utf,
+    typename Outf,
+    typename Policy = error_throw,
+    typename It,
+    typename Eit,
+    typename Oit,
+    typename std::enable_if<is_error_policy<Policy>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy, typename std::decay<It>::type, typename std::decay<Oit>::type>::type conv(It && it, Eit && eit, Oit && oit)
 {
-    std::basic_string<Och> res;
-    conv<utf_selector_t<Och>>(std::forward<Str>(str), std::back_inserter(res));
-    return res;
+    return detail::conv_selector<Utf, Outf, Policy,
+            typename std::decay<It>::type,
+            typename std::decay<Oit>::type>::apply(
+        std::forward<It>(it),
+        std::forward<Eit>(eit),
+        std::forward<Oit>(oit));
+}
+
+namespace detail {
+
+enum struct policy_conv_impl { normal, contiguous };
+
+template<typename Outf>
+uint32_t replacement_for() throw()
+{
+    return Outf::encodable(replacement_code_point) ? replacement_code_point : '?';
+}
+
+// Converts the symbols one by one and handles the malformed ones according to the policy. The overlong forms of zero
+// terminate the null-terminated input like they do for `convz`.
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename It,
+    typename Oit,
+    policy_conv_impl>
+struct policy_conv_strategy final
+{
+    using result = conv_result_selector<Policy, It, Oit>;
+
+    template<typename Eit>
+    typename result::type operator()(It it, Eit const eit, Oit oit) const
+    {
+        auto const write_fn = [&oit] (typename Outf::char_type const ch) { *oit++ = ch; };
+        while (it != eit)
+        {
+            auto const first = it;
+            uint32_t cp;
+            auto error = Utf::decode(it, eit, cp);
+            if (error == utf_error::none)
+            {
+                if (!cp && std::is_same<Eit, null_terminator>::value)
+                    return result::make(first, oit, utf_error::none);
+                if (Outf::encodable(cp))
+                {
+                    symbol_writer<Outf, Oit>::encode(cp, oit);
+                    continue;
+                }
+                error = utf_error::invalid_code_point;
+            }
+            if (error_handler<Policy>::stop)
+                return result::make(first, oit, error);
+            if (error_handler<Policy>::replace)
+                Outf::encode(replacement_for<Outf>(), write_fn);
+        }
+        return result::make(it, oit, utf_error::none);
+    }
+};
+
+// The valid runs found by the validator are converted like by `conv`, which can not fail on them when every code point
+// of `Utf` is encodable by `Outf`, but without the checks. Only the malformed symbols are decoded one by one.
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename It,
+    typename Oit>
+struct policy_conv_strategy<Utf, Outf, Policy, It, Oit, policy_conv_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+    using result = conv_result_selector<Policy, It, Oit>;
+
+    typename result::type operator()(It const first, char_type const * const eit, Oit oit) const
+    {
+        auto const write_fn = [&oit] (typename Outf::char_type const ch) { *oit++ = ch; };
+        char_type const * it = first;
+        while (true)
+        {
+            auto const valid_eit = validate<Utf>(it, eit);
+            oit = valid_conv_strategy<Utf, Outf, char_type, Oit>()(it, valid_eit, oit);
+            if (valid_eit == eit)
+                return result::make(first + (eit - static_cast<char_type const *>(first)), oit, utf_error::none);
+            it = valid_eit;
+            uint32_t cp;
+            auto const error = Utf::decode(it, eit, cp);
+            if (error_handler<Policy>::stop)
+                return result::make(first + (valid_eit - static_cast<char_type const *>(first)), oit, error);
+            if (error_handler<Policy>::replace)
+                Outf::encode(replacement_for<Outf>(), write_fn);
+        }
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename It,
+    typename Oit>
+typename conv_result_selector<Policy, It, Oit>::type conv_selector<Utf, Outf, Policy, It, Oit>::apply(It it, It eit, Oit oit)
+{
+    return policy_conv_strategy<Utf, Outf, Policy, It, Oit,
+            is_contiguous_input<Utf, It>::value && Utf::max_supported_code_point <= Outf::max_supported_code_point
+                ? policy_conv_impl::contiguous
+                : policy_conv_impl::normal>()(it, eit, oit);
+}
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename It,
+    typename Oit>
+struct convz_selector final
+{
+    static typename conv_result_selector<Policy, It, Oit>::type apply(It it, Oit oit)
+    {
+        return policy_conv_strategy<Utf, Outf, Policy, It, Oit, policy_conv_impl::normal>()(it, null_terminator(), oit);
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+struct convz_selector<Utf, Outf, error_throw, It, Oit> final
+{
+    static Oit apply(It it, Oit oit)
+    {
+        return convz_strategy<Utf, Outf, It, Oit,
+                std::is_same<Utf, Outf>::value
+                    ? convz_impl::binary_copy
+                    : convz_impl::normal>()(it, oit);
+    }
+};
+
+}
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy = error_throw,
+    typename It,
+    typename Oit,
+    typename std::enable_if<is_error_policy<Policy>::value && !is_error_policy<Outf>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy, typename std::decay<It>::type, typename std::decay<Oit>::type>::type convz(It && it, Oit && oit)
+{
+    return detail::convz_selector<Utf, Outf, Policy,
+            typename std::decay<It>::type,
+            typename std::decay<Oit>::type>::apply(
+        std::forward<It>(it),
+        std::forward<Oit>(oit));
+}
+
+// The end of the consumed input and the end of the written output
+template<
+    typename It,
+    typename Oit>
+struct conv_result final
+{
+    It in;
+    Oit out;
+};
+
+namespace detail {
+
+// Converts one symbol if it fits into the `room` output units, otherwise nothing is consumed
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+bool conv_symbol_into(It & it, It const eit, Oit & oit, size_t & room)
+{
+    using och_type = typename Outf::char_type;
+    auto next = it;
+    auto const read_fn = [&next, &eit]
+        {
+            if (next == eit)
+                throw std::runtime_error("Not enough input");
+            return *next++;
+        };
+    och_type buf[Outf::max_supported_symbol_size];
+    auto ebuf = buf;
+    Outf::write(Utf::read(read_fn), [&ebuf] (och_type const ch) { *ebuf++ = ch; });
+    auto const size = static_cast<size_t>(ebuf - buf);
+    if (size > room)
+        return false;
+    oit = std::copy(buf, ebuf, oit);
+    room -= size;
+    it = next;
+    return true;
+}
+
+enum struct conv_into_impl { normal, contiguous };
+
+// The same encoding is converted symbol by symbol too, so the output never ends in the middle of a symbol
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit,
+    conv_into_impl>
+struct conv_into_strategy final
+{
+    conv_result<It, Oit> operator()(It it, It const eit, Oit oit, Oit const eoit) const
+    {
+        auto room = static_cast<size_t>(std::distance(oit, eoit));
+        while (it != eit && conv_symbol_into<Utf, Outf>(it, eit, oit, room))
+            ;
+        return {it, oit};
+    }
+};
+
+// The block is limited by the output room, the rest is converted symbol by symbol
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+struct conv_into_strategy<Utf, Outf, It, Oit, conv_into_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    conv_result<It, Oit> operator()(It const first, char_type const * const eit, Oit oit, Oit const eoit) const
+    {
+        char_type const * it = first;
+        auto room = static_cast<size_t>(std::distance(oit, eoit));
+        if (static_cast<size_t>(eit - it) >= Utf::max_supported_symbol_size)
+        {
+            block_conv_writer<Utf, Outf, char_type, Oit, block_output_selector<Utf, Outf, Oit>::value> block_write;
+            auto const fast_eit = eit - Utf::max_supported_symbol_size;
+            while (it < fast_eit)
+            {
+                auto const block_size = room / block_conv<Utf, Outf>::max_ratio;
+                if (block_size >= Utf::max_supported_symbol_size && block_conv<Utf, Outf>::accepts(it))
+                {
+                    auto const prev = oit;
+                    block_write(it, it + std::min(static_cast<size_t>(eit - it), block_size), oit);
+                    room -= static_cast<size_t>(std::distance(prev, oit));
+                }
+                else if (!conv_symbol_into<Utf, Outf>(it, eit, oit, room))
+                    return {first + (it - static_cast<char_type const *>(first)), oit};
+            }
+        }
+        while (it != eit && conv_symbol_into<Utf, Outf>(it, eit, oit, room))
+            ;
+        return {first + (it - static_cast<char_type const *>(first)), oit};
+    }
+};
+
+}
+
+// Converts the input until the output range is full. The output is never written past `eoit` and always ends on the
+// symbol boundary. Returns the end of the consumed input and the end of the written output.
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Eit,
+    typename Oit,
+    typename Eoit>
+conv_result<typename std::decay<It>::type, typename std::decay<Oit>::type> conv_into(It && it, Eit && eit, Oit && oit, Eoit && eoit)
+{
+    return detail::conv_into_strategy<Utf, Outf,
+            typename std::decay<It>::type,
+            typename std::decay<Oit>::type,
+            !std::is_same<Utf, Outf>::value && detail::block_conv<Utf, Outf>::enabled && detail::is_contiguous_input<Utf, typename std::decay<It>::type>::value
+                ? detail::conv_into_impl::contiguous
+                : detail::conv_into_impl::normal>()(
+        std::forward<It>(it),
+        std::forward<Eit>(eit),
+        std::forward<Oit>(oit),
+        std::forward<Eoit>(eoit));
+}
+
+// Converts the input from the last symbol to the first one, every symbol is written in the usual order of units
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Oit>
+Oit conv_back(It const first, It it, Oit oit)
+{
+    auto const read_back_fn = [&first, &it]
+        {
+            if (it == first)
+                throw std::runtime_error("Not enough input");
+            return *--it;
+        };
+    auto const write_fn = [&oit] (typename Outf::char_type const ch) { *oit++ = ch; };
+    while (it != first)
+        Outf::write(Utf::read_back(read_back_fn), write_fn);
+    return oit;
+}
+
+template<
+    typename Outf,
+    typename Ch,
+    typename Oit>
+typename std::decay<Oit>::type conv_back(std::basic_string<Ch> const & str, Oit && oit)
+{
+    return conv_back<utf_selector_t<Ch>, Outf>(str.data(), str.data() + str.size(), std::forward<Oit>(oit));
+}
+
+template<
+    typename Outf,
+    typename Ch,
+    typename Oit,
+    typename Eoit>
+conv_result<Ch const *, typename std::decay<Oit>::type> conv_into(std::basic_string<Ch> const & str, Oit && oit, Eoit && eoit)
+{
+    return conv_into<utf_selector_t<Ch>, Outf>(str.data(), str.data() + str.size(), std::forward<Oit>(oit), std::forward<Eoit>(eoit));
+}
+
+#if __cpp_lib_string_view >= 201606
+template<
+    typename Outf,
+    typename Ch,
+    typename Oit,
+    typename Eoit>
+conv_result<Ch const *, typename std::decay<Oit>::type> conv_into(std::basic_string_view<Ch> const & str, Oit && oit, Eoit && eoit)
+{
+    return conv_into<utf_selector_t<Ch>, Outf>(str.data(), str.data() + str.size(), std::forward<Oit>(oit), std::forward<Eoit>(eoit));
+}
+#endif
+
+template<
+    typename Outf,
+    typename Policy = error_throw,
+    typename Ch,
+    typename Oit,
+    typename std::enable_if<is_error_policy<Policy>::value && !detail::is_allocator<typename std::decay<Oit>::type>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy, Ch const *, typename std::decay<Oit>::type>::type convz(Ch const * const str, Oit && oit)
+{
+    return convz<utf_selector_t<Ch>, Outf, Policy>(str, std::forward<Oit>(oit));
+}
+
+namespace detail {
+
+template<typename Utf>
+struct native_codec final { using type = Utf; };
+
+template<typename Utf>
+struct native_codec<utf_swapped<Utf>> final { using type = Utf; };
+
+// The maximum number of `Outf` units per `Utf` unit of the valid input. No code point takes more units than in UTF-8.
+template<
+    typename Utf,
+    typename Outf>
+struct valid_conv_ratio final : std::integral_constant<size_t, Outf::max_supported_symbol_size> {};
+
+template<typename Outf>
+struct valid_conv_ratio<utf8, Outf> final : std::integral_constant<size_t, 1> {};
+
+template<typename Outf>
+struct valid_conv_ratio<utf8_dfa, Outf> final : std::integral_constant<size_t, 1> {};
+
+template<typename Outf>
+struct valid_conv_ratio<ascii, Outf> final : std::integral_constant<size_t, 1> {};
+
+template<>
+struct valid_conv_ratio<utf16, utf8> final : std::integral_constant<size_t, 3> {};
+
+template<>
+struct valid_conv_ratio<latin1, utf8> final : std::integral_constant<size_t, 2> {};
+
+// Every replacement of the malformed symbol takes at most `Outf::max_unicode_symbol_size` units
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    size_t valid_ratio = std::is_same<Utf, Outf>::value
+        ? 1
+        : valid_conv_ratio<typename native_codec<Utf>::type, typename native_codec<Outf>::type>::value>
+struct max_conv_ratio final : std::integral_constant<size_t,
+    !std::is_same<Policy, error_replace>::value || valid_ratio >= Outf::max_unicode_symbol_size
+        ? valid_ratio
+        : Outf::max_unicode_symbol_size> {};
+
+template<
+    typename Conv,
+    bool = Conv::enabled>
+struct block_overrun final : std::integral_constant<size_t, 0> {};
+
+template<typename Conv>
+struct block_overrun<Conv, true> final : std::integral_constant<size_t, Conv::overrun> {};
+
+// The output room `room_conv_selector` needs for the input of `size` units
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy>
+size_t room_size(size_t const size) throw()
+{
+    return size * max_conv_ratio<Utf, Outf, Policy>::value +
+        (std::is_same<Policy, error_throw>::value ? block_overrun<block_conv<Utf, Outf>>::value : 0);
+}
+
+// Converts to the output of `room_size` units, the kernel overrun fits into it
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Ch,
+    typename Och>
+struct room_conv_selector final
+{
+    static typename conv_result_selector<Policy, Ch const *, Och *>::type apply(Ch const * const it, Ch const * const eit, Och * const oit)
+    {
+        return conv_selector<Utf, Outf, Policy, Ch const *, Och *>::apply(it, eit, oit);
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Och>
+struct room_conv_selector<Utf, Outf, error_throw, Ch, Och> final
+{
+    static Och * apply(Ch const * const it, Ch const * const eit, Och * const oit)
+    {
+        return conv_strategy<Utf, Outf, Ch const *, Och *,
+                std::is_same<Utf, Outf>::value
+                    ? conv_impl::binary_copy
+                    : block_conv<Utf, Outf>::enabled && is_contiguous_input<Utf, Ch const *>::value
+                        ? conv_impl::contiguous_room
+                        : conv_impl::random_interator>()(it, eit, oit);
+    }
+};
+
+template<typename Och>
+Och * output_end(Och * const oit) throw()
+{
+    return oit;
+}
+
+template<
+    typename It,
+    typename Och>
+Och * output_end(conv_status<It, Och *> const & status) throw()
+{
+    return status.out;
+}
+
+template<
+    typename Och,
+    typename Oit>
+Oit rebind_output(Och * const, Oit oit)
+{
+    return oit;
+}
+
+template<
+    typename It,
+    typename Och,
+    typename Oit>
+conv_status<It, Oit> rebind_output(conv_status<It, Och *> const & status, Oit oit)
+{
+    return {status.in, oit, status.error};
+}
+
+// The worst case room is given back when the most of it is left unused. The capacity of the caller is kept.
+template<typename Container>
+void shrink_room(Container & res, size_t const old_capacity)
+{
+    if (res.capacity() > old_capacity && res.capacity() - res.size() > res.size() / 4)
+        res.shrink_to_fit();
+}
+
+template<
+    typename Container,
+    typename WriteFn>
+auto overwrite_grown(Container & res, size_t const old_size, size_t const old_capacity, WriteFn & write_fn)
+    -> decltype(write_fn(static_cast<typename Container::value_type *>(nullptr)))
+{
+    auto const oit = &res[0] + old_size;
+    auto const result = write_fn(oit);
+    res.resize(old_size + static_cast<size_t>(output_end(result) - oit));
+    shrink_room(res, old_capacity);
+    return result;
+}
+
+// Grows the container by `size` units at once, `write_fn` writes at most `size` units to the pointer, then the
+// container is shrunk to the written units. Nothing is appended if `write_fn` throws. It is called with the null
+// pointer for the empty input.
+template<
+    typename Container,
+    typename WriteFn>
+auto append_overwrite(Container & res, size_t const size, WriteFn && write_fn)
+    -> decltype(write_fn(static_cast<typename Container::value_type *>(nullptr)))
+{
+    if (!size)
+        return write_fn(static_cast<typename Container::value_type *>(nullptr));
+    auto const old_size = res.size();
+    auto const old_capacity = res.capacity();
+    res.resize(old_size + size);
+#if defined(WW898_UTF_EXCEPTIONS)
+    try
+    {
+        return overwrite_grown(res, old_size, old_capacity, write_fn);
+    }
+    catch (...)
+    {
+        res.resize(old_size);
+        throw;
+    }
+#else
+    return overwrite_grown(res, old_size, old_capacity, write_fn);
+#endif
+}
+
+#if __cpp_lib_string_resize_and_overwrite >= 202110
+// The grown chars are not initialized
+template<
+    typename Och,
+    typename Traits,
+    typename Alloc,
+    typename WriteFn>
+auto append_overwrite(std::basic_string<Och, Traits, Alloc> & res, size_t const size, WriteFn && write_fn)
+    -> decltype(write_fn(static_cast<Och *>(nullptr)))
+{
+    // Note: The behavior is undefined if the operation of `resize_and_overwrite` throws
+    decltype(write_fn(static_cast<Och *>(nullptr))) result{};
+    auto const old_size = res.size();
+    auto const old_capacity = res.capacity();
+#if defined(WW898_UTF_EXCEPTIONS)
+    std::exception_ptr error;
+    res.resize_and_overwrite(old_size + size, [&] (Och * const buf, size_t) -> size_t
+        {
+            try
+            {
+                result = write_fn(buf + old_size);
+                return static_cast<size_t>(output_end(result) - buf);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                return old_size;
+            }
+        });
+    if (error)
+        std::rethrow_exception(error);
+#else
+    res.resize_and_overwrite(old_size + size, [&] (Och * const buf, size_t) -> size_t
+        {
+            result = write_fn(buf + old_size);
+            return static_cast<size_t>(output_end(result) - buf);
+        });
+#endif
+    shrink_room(res, old_capacity);
+    return result;
+}
+#endif
+
+// Only the strings of C++23 grow without zero filling. Otherwise for the pairs whose worst case room exceeds the input
+// the exact output size is counted and reserved, the filling of the larger room costs more than the counting.
+template<typename Container>
+struct uninitialized_growth final : std::false_type {};
+
+#if __cpp_lib_string_resize_and_overwrite >= 202110
+template<
+    typename Och,
+    typename Traits,
+    typename Alloc>
+struct uninitialized_growth<std::basic_string<Och, Traits, Alloc>> final : std::true_type {};
+#endif
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Container>
+struct exact_reserve final : std::integral_constant<bool,
+    std::is_same<Policy, error_throw>::value &&
+    (max_conv_ratio<Utf, Outf, Policy>::value > 1) &&
+    !uninitialized_growth<Container>::value> {};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Container,
+    bool = exact_reserve<Utf, Outf, Policy, Container>::value>
+struct conv_appender final
+{
+    using och_type = typename Container::value_type;
+
+    template<typename Ch>
+    static typename conv_result_selector<Policy, Ch const *, std::back_insert_iterator<Container>>::type apply(
+        Ch const * const first, Ch const * const last, Container & res)
+    {
+        return rebind_output(
+            append_overwrite(res, room_size<Utf, Outf, Policy>(static_cast<size_t>(last - first)),
+                [first, last] (och_type * const oit)
+                {
+                    return room_conv_selector<Utf, Outf, Policy, Ch, och_type>::apply(first, last, oit);
+                }),
+            std::back_inserter(res));
+    }
+
+    template<typename Ch>
+    static void applyz(Ch const * const first, Ch const * const last, Container & res)
+    {
+        append_overwrite(res, room_size<Utf, Outf, Policy>(static_cast<size_t>(last - first)),
+            [first] (och_type * const oit) { return convz<Utf, Outf, Policy>(first, oit); });
+    }
+};
+
+// The exact size throws the same errors as `conv` before anything is appended
+template<
+    typename Utf,
+    typename Outf,
+    typename Policy,
+    typename Container>
+struct conv_appender<Utf, Outf, Policy, Container, true> final
+{
+    template<typename Ch>
+    static std::back_insert_iterator<Container> apply(Ch const * const first, Ch const * const last, Container & res)
+    {
+        res.reserve(res.size() + converted_size<Utf, Outf>(first, last));
+        return conv<Utf, Outf>(first, last, std::back_inserter(res));
+    }
+
+    template<typename Ch>
+    static void applyz(Ch const * const first, Ch const *, Container & res)
+    {
+        res.reserve(res.size() + converted_sizez<Utf, Outf>(first));
+        convz<Utf, Outf>(first, std::back_inserter(res));
+    }
+};
+
+}
+
+// The output grows once to the worst case size and is shrunk to the converted units. With `error_stop` the output
+// ends before the first malformed symbol.
+template<
+    typename Och,
+    typename Policy = error_throw,
+    typename Str,
+    typename Alloc,
+    typename std::enable_if<is_error_policy<Policy>::value && detail::is_allocator<Alloc>::value, void *>::type = nullptr>
+std::basic_string<Och, std::char_traits<Och>, Alloc> convz(Str && str, Alloc const & alloc)
+{
+    using ch_type = typename std::remove_cv<typename std::remove_pointer<typename std::decay<Str>::type>::type>::type;
+    using utf_type = utf_selector_t<ch_type>;
+    using outf_type = utf_selector_t<Och>;
+    ch_type const * const first = str;
+    auto last = first;
+    while (*last)
+        ++last;
+    std::basic_string<Och, std::char_traits<Och>, Alloc> res(alloc);
+    detail::conv_appender<utf_type, outf_type, Policy, decltype(res)>::applyz(first, last, res);
+    return res;
+}
+
+template<
+    typename Och,
+    typename Policy = error_throw,
+    typename Str,
+    typename std::enable_if<is_error_policy<Policy>::value, void *>::type = nullptr>
+std::basic_string<Och> convz(Str && str)
+{
+    return convz<Och, Policy>(std::forward<Str>(str), std::allocator<Och>());
+}
+
+template<
+    typename Outf,
+    typename Policy = error_throw,
+    typename Ch,
+    typename Traits,
+    typename Alloc,
+    typename Oit,
+    typename std::enable_if<is_error_policy<Policy>::value && !detail::is_allocator<typename std::decay<Oit>::type>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy, Ch const *, typename std::decay<Oit>::type>::type conv(std::basic_string<Ch, Traits, Alloc> const & str, Oit && oit)
+{
+    return conv<utf_selector_t<Ch>, Outf, Policy>(str.data(), str.data() + str.size(), std::forward<Oit>(oit));
+}
+
+#if __cpp_lib_string_view >= 201606
+template<
+    typename Outf,
+    typename Policy = error_throw,
+    typename Ch,
+    typename Oit,
+    typename std::enable_if<is_error_policy<Policy>::value && !detail::is_allocator<typename std::decay<Oit>::type>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy, Ch const *, typename std::decay<Oit>::type>::type conv(std::basic_string_view<Ch> const & str, Oit && oit)
+{
+    return conv<utf_selector_t<Ch>, Outf, Policy>(str.data(), str.data() + str.size(), std::forward<Oit>(oit));
+}
+#endif
+
+// Appends the converted contiguous input to the string or the vector of `Och`, the memory comes from its allocator.
+// The container grows once to the worst case size, the units are written through the pointer and the container is
+// shrunk to the converted ones, the unused worst case room is given back. Before C++23 the pairs growing more than
+// the input reserve the counted size instead. Nothing is appended if the malformed input throws.
+template<
+    typename Policy = error_throw,
+    typename Str,
+    typename Container,
+    typename std::enable_if<is_error_policy<Policy>::value, void *>::type = nullptr>
+typename detail::conv_result_selector<Policy,
+    typename std::decay<Str>::type::value_type const *,
+    std::back_insert_iterator<Container>>::type conv_append(Str && str, Container & res)
+{
+    using ch_type = typename std::decay<Str>::type::value_type;
+    using och_type = typename Container::value_type;
+    using utf_type = utf_selector_t<ch_type>;
+    using outf_type = utf_selector_t<och_type>;
+    ch_type const * const first = str.data();
+    return detail::conv_appender<utf_type, outf_type, Policy, Container>::apply(first, first + str.size(), res);
+}
+
+// The string is allocated by `alloc`, e.g. `std::pmr::polymorphic_allocator<Och>` gives `std::pmr::basic_string<Och>`
+template<
+    typename Och,
+    typename Policy = error_throw,
+    typename Str,
+    typename Alloc,
+    typename std::enable_if<is_error_policy<Policy>::value && detail::is_allocator<Alloc>::value, void *>::type = nullptr>
+std::basic_string<Och, std::char_traits<Och>, Alloc> conv(Str && str, Alloc const & alloc)
+{
+    std::basic_string<Och, std::char_traits<Och>, Alloc> res(alloc);
+    conv_append<Policy>(std::forward<Str>(str), res);
+    return res;
+}
+
+template<
+    typename Och,
+    typename Policy = error_throw,
+    typename Str,
+    typename std::enable_if<
+        is_error_policy<Policy>::value &&
+        !(std::is_same<Policy, error_throw>::value && std::is_same<typename std::decay<Str>::type, std::basic_string<Och>>::value), void *>::type = nullptr>
+std::basic_string<Och> conv(Str && str)
+{
+    return conv<Och, Policy>(std::forward<Str>(str), std::allocator<Och>());
 }
 
 template<
@@ -0,0 +1,294 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_validate.hpp>
+#include <ww898/utf_dispatch.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(WW898_UTF_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(WW898_UTF_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace ww898 {
+namespace utf {
+
+enum struct encoding { unknown, utf8, utf16le, utf16be, utf32le, utf32be };
+
+struct detected_encoding final
+{
+    encoding value;
+    // The byte order mark size in bytes, the text starts right after it
+    size_t bom_size;
+    // From 0 when nothing fits to 1 when the byte order mark is found, the input is valid UTF-8 without zero bytes or
+    // every unit is a valid UTF-32 code point
+    double confidence;
+};
+
+static size_t const default_detect_prefix = 16 * 1024;
+
+namespace detail {
+
+// The byte counts by the position modulo 4
+struct byte_stats final
+{
+    // The zero bytes
+    size_t zeros[4];
+    // The bytes not greater than 0x10, the plane byte of UTF-32 is always such
+    size_t smalls[4];
+    // The bytes equal to the byte two positions ahead, the high bytes of UTF-16 repeat within the script block
+    size_t repeats[4];
+};
+
+template<typename Ch>
+using byte_stats_kernel = void (*)(Ch const *, Ch const *, byte_stats &);
+
+template<isa level>
+struct count_byte_stats : count_byte_stats<kernel_fallback<level>::value> {};
+
+template<>
+struct count_byte_stats<isa::scalar>
+{
+    template<typename Ch>
+    static void run(Ch const * it, Ch const * const eit, byte_stats & stats) throw()
+    {
+        for (size_t n = 0; it != eit; ++it, ++n)
+        {
+            uint8_t const ch = *it;
+            stats.zeros[n % 4] += !ch;
+            stats.smalls[n % 4] += ch <= 0x10;
+            stats.repeats[n % 4] += eit - it > 2 && ch == static_cast<uint8_t>(it[2]);
+        }
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct count_byte_stats<isa::sse2>
+{
+    template<typename Ch>
+    static void run(Ch const * it, Ch const * const eit, byte_stats & stats) throw()
+    {
+        auto const zero = _mm_setzero_si128();
+        auto const small = _mm_set1_epi8(0x10);
+        while (eit - it >= 18)
+        {
+            // The byte counters are flushed before they overflow
+            auto zeros = _mm_setzero_si128();
+            auto smalls = _mm_setzero_si128();
+            auto repeats = _mm_setzero_si128();
+            for (size_t n = 0; n < 255 && eit - it >= 18; ++n, it += 16)
+            {
+                auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+                auto const ahead = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it + 2));
+                zeros = _mm_sub_epi8(zeros, _mm_cmpeq_epi8(v, zero));
+                smalls = _mm_sub_epi8(smalls, _mm_cmpeq_epi8(_mm_min_epu8(v, small), v));
+                repeats = _mm_sub_epi8(repeats, _mm_cmpeq_epi8(v, ahead));
+            }
+            uint8_t lanes[3][16];
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[0]), zeros);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[1]), smalls);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[2]), repeats);
+            for (size_t n = 0; n < 16; ++n)
+            {
+                stats.zeros[n % 4] += lanes[0][n];
+                stats.smalls[n % 4] += lanes[1][n];
+                stats.repeats[n % 4] += lanes[2][n];
+            }
+        }
+        count_byte_stats<isa::scalar>::run(it, eit, stats);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct count_byte_stats<isa::avx2>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * it, Ch const * const eit, byte_stats & stats) throw()
+    {
+        auto const zero = _mm256_setzero_si256();
+        auto const small = _mm256_set1_epi8(0x10);
+        while (eit - it >= 34)
+        {
+            auto zeros = _mm256_setzero_si256();
+            auto smalls = _mm256_setzero_si256();
+            auto repeats = _mm256_setzero_si256();
+            for (size_t n = 0; n < 255 && eit - it >= 34; ++n, it += 32)
+            {
+                auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+                auto const ahead = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it + 2));
+                zeros = _mm256_sub_epi8(zeros, _mm256_cmpeq_epi8(v, zero));
+                smalls = _mm256_sub_epi8(smalls, _mm256_cmpeq_epi8(_mm256_min_epu8(v, small), v));
+                repeats = _mm256_sub_epi8(repeats, _mm256_cmpeq_epi8(v, ahead));
+            }
+            uint8_t lanes[3][32];
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[0]), zeros);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[1]), smalls);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes[2]), repeats);
+            for (size_t n = 0; n < 32; ++n)
+            {
+                stats.zeros[n % 4] += lanes[0][n];
+                stats.smalls[n % 4] += lanes[1][n];
+                stats.repeats[n % 4] += lanes[2][n];
+            }
+        }
+        count_byte_stats<isa::sse2>::run(it, eit, stats);
+    }
+};
+#endif
+
+// The byte order marks of UTF-32 go first, UTF-32LE one starts with UTF-16LE one
+inline detected_encoding detect_bom(uint8_t const * const first, size_t const size) throw()
+{
+    static struct
+    {
+        uint8_t bytes[4];
+        size_t size;
+        encoding value;
+    } const boms[] =
+    {
+        { { 0xFF, 0xFE, 0x00, 0x00 }, 4, encoding::utf32le },
+        { { 0x00, 0x00, 0xFE, 0xFF }, 4, encoding::utf32be },
+        { { 0xEF, 0xBB, 0xBF       }, 3, encoding::utf8    },
+        { { 0xFF, 0xFE             }, 2, encoding::utf16le },
+        { { 0xFE, 0xFF             }, 2, encoding::utf16be },
+    };
+    for (auto const & bom : boms)
+        if (size >= bom.size && !std::memcmp(first, bom.bytes, bom.size))
+            return { bom.value, bom.size, 1.0 };
+    return { encoding::unknown, 0, 0.0 };
+}
+
+// The prefix cut from the longer input can end with the incomplete symbol
+template<typename Utf>
+bool valid_prefix(uint8_t const * const first, size_t const size, bool const cut)
+{
+    using unit_type = typename Utf::char_type;
+    auto const count = size / sizeof(unit_type);
+    if (!cut && count * sizeof(unit_type) != size)
+        return false;
+    std::vector<unit_type> units(count);
+    if (count)
+        std::memcpy(units.data(), first, count * sizeof(unit_type));
+    auto const data = units.data();
+    auto const it = validate<Utf>(data, data + count);
+    return cut
+        ? static_cast<size_t>(data + count - it) < Utf::max_supported_symbol_size
+        : it == data + count;
+}
+
+}
+
+// Detects the encoding by the byte order mark, otherwise by the zero byte pattern and validity of the prefix of at
+// most `max_prefix` bytes. The UTF-16 text of the large scripts without ASCII chars, e.g. CJK, is detected with the
+// low confidence only.
+template<typename Ch>
+detected_encoding detect_encoding(Ch const * const first, Ch const * const last, size_t const max_prefix = default_detect_prefix)
+{
+    static_assert(sizeof(Ch) == 1, "The raw bytes are expected");
+    auto const bytes = reinterpret_cast<uint8_t const *>(first);
+    auto const total = static_cast<size_t>(last - first);
+    auto const bom = detail::detect_bom(bytes, total);
+    if (bom.value != encoding::unknown)
+        return bom;
+
+    auto const size = std::min(total, max_prefix);
+    auto const cut = size < total;
+    // Only the whole UTF-32 units are counted, so the high bytes of every one are on the same positions
+    auto const units32 = size / 4;
+    detail::byte_stats stats = {};
+    detail::dispatch<detail::byte_stats_kernel<uint8_t>, detail::count_byte_stats, uint8_t>()(bytes, bytes + units32 * 4, stats);
+    auto const & zeros = stats.zeros;
+    // The zero bytes after the last whole UTF-32 unit are not counted above
+    auto const tail_zero = std::memchr(bytes + units32 * 4, 0, size - units32 * 4) != nullptr;
+    auto const valid_utf8 = detail::valid_prefix<utf8>(bytes, size, cut);
+    if (zeros[0] + zeros[1] + zeros[2] + zeros[3] == 0 && !tail_zero && valid_utf8)
+        return { encoding::utf8, 0, 1.0 };
+
+    // Every UTF-32 unit has the zero high byte and the plane byte not greater than 0x10
+    auto const & smalls = stats.smalls;
+    if (units32 && zeros[3] == units32 && smalls[2] == units32 && detail::valid_prefix<utf32le>(bytes, size, cut))
+        return { encoding::utf32le, 0, 1.0 };
+    if (units32 && zeros[0] == units32 && smalls[1] == units32 && detail::valid_prefix<utf32be>(bytes, size, cut))
+        return { encoding::utf32be, 0, 1.0 };
+
+    // The high bytes of UTF-16LE are on the odd positions
+    auto const units16 = units32 * 2;
+    auto const odd = stats.repeats[1] + stats.repeats[3];
+    auto const even = stats.repeats[0] + stats.repeats[2];
+    if (odd > even * 2 && detail::valid_prefix<utf16le>(bytes, size, cut))
+        return { encoding::utf16le, 0, static_cast<double>(odd - even) / units16 };
+    if (even > odd * 2 && detail::valid_prefix<utf16be>(bytes, size, cut))
+        return { encoding::utf16be, 0, static_cast<double>(even - odd) / units16 };
+
+    if (valid_utf8)
+        return { encoding::utf8, 0, 0.5 };
+    if (detail::valid_prefix<utf16le>(bytes, size, cut))
+        return { encoding::utf16le, 0, 0.25 };
+    if (detail::valid_prefix<utf16be>(bytes, size, cut))
+        return { encoding::utf16be, 0, 0.25 };
+    return { encoding::unknown, 0, 0.0 };
+}
+
+template<typename Ch>
+detected_encoding detect_encoding(std::basic_string<Ch> const & str, size_t const max_prefix = default_detect_prefix)
+{
+    return detect_encoding(str.data(), str.data() + str.size(), max_prefix);
+}
+
+// Calls `fn` with the codec of the encoding, e.g. `utf16be()`, so the matching `conv<Utf, Outf>` is instantiated for
+// every encoding
+template<typename Fn>
+auto visit_encoding(encoding const value, Fn && fn) -> decltype(fn(utf8()))
+{
+    switch (value)
+    {
+    case encoding::utf8   : return fn(utf8   ());
+    case encoding::utf16le: return fn(utf16le());
+    case encoding::utf16be: return fn(utf16be());
+    case encoding::utf32le: return fn(utf32le());
+    case encoding::utf32be: return fn(utf32be());
+    default:
+        throw std::runtime_error("Unknown encoding");
+    }
+}
+
+}}
@@ -0,0 +1,203 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+
+#if defined(WW898_UTF_AVX2)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace ww898 {
+namespace utf {
+
+// The instruction sets the kernels are compiled for. Every level includes all lower ones.
+enum struct isa { scalar, sse2, avx2, avx512 };
+
+namespace detail {
+
+static size_t const isa_count = static_cast<size_t>(isa::avx512) + 1;
+
+#if defined(WW898_UTF_AVX2)
+inline void cpuid(uint32_t const leaf, uint32_t (& regs)[4]) throw()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), 0);
+    for (size_t n = 0; n < 4; ++n)
+        regs[n] = static_cast<uint32_t>(info[n]);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+inline uint64_t xgetbv() throw()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return static_cast<uint64_t>(hi) << 32 | lo;
+#endif
+}
+#endif
+
+inline isa detect_isa() throw()
+{
+#if defined(WW898_UTF_AVX2)
+    uint32_t regs[4];
+    cpuid(0, regs);
+    if (regs[0] < 7)
+        return isa::sse2;
+    cpuid(1, regs);
+    // Both CPU and OS should support AVX: OSXSAVE (bit 27) and AVX (bit 28)
+    if ((regs[2] & 0x18000000) != 0x18000000)
+        return isa::sse2;
+    // XMM and YMM state
+    auto const xcr0 = xgetbv();
+    if ((xcr0 & 0x06) != 0x06)
+        return isa::sse2;
+    cpuid(7, regs);
+    // AVX2 (bit 5)
+    if (!(regs[1] & 0x00000020))
+        return isa::sse2;
+#if defined(WW898_UTF_AVX512)
+    // AVX512F (bit 16), AVX512BW (bit 30) and opmask, ZMM_Hi256, Hi16_ZMM state
+    if ((regs[1] & 0x40010000) == 0x40010000 && (xcr0 & 0xE6) == 0xE6)
+        return isa::avx512;
+#endif
+    return isa::avx2;
+#elif defined(WW898_UTF_SSE2)
+    return isa::sse2;
+#else
+    return isa::scalar;
+#endif
+}
+
+inline isa min_isa(isa const x, isa const y) throw()
+{
+    return static_cast<int>(x) < static_cast<int>(y) ? x : y;
+}
+
+// The `WW898_UTF_ISA` environment variable (`scalar`, `sse2`, `avx2` or `avx512`) limits the initial instruction set
+inline isa initial_isa(isa const supported) throw()
+{
+    static char const * const names[isa_count] = { "scalar", "sse2", "avx2", "avx512" };
+#if defined(_MSC_VER)
+    char * value = nullptr;
+    size_t length = 0;
+    if (_dupenv_s(&value, &length, "WW898_UTF_ISA") || !value)
+        return supported;
+    auto res = supported;
+    for (size_t n = 0; n < isa_count; ++n)
+        if (!std::strcmp(value, names[n]))
+            res = min_isa(static_cast<isa>(n), supported);
+    std::free(value);
+    return res;
+#else
+    auto const value = std::getenv("WW898_UTF_ISA");
+    if (!value)
+        return supported;
+    for (size_t n = 0; n < isa_count; ++n)
+        if (!std::strcmp(value, names[n]))
+            return min_isa(static_cast<isa>(n), supported);
+    return supported;
+#endif
+}
+
+}
+
+// The best instruction set supported by both the build and the CPU
+inline isa supported_isa() throw()
+{
+    static isa const value = detail::detect_isa();
+    return value;
+}
+
+namespace detail {
+
+inline std::atomic<isa> & active_isa_holder() throw()
+{
+    static std::atomic<isa> value(initial_isa(supported_isa()));
+    return value;
+}
+
+}
+
+// The instruction set the kernels are currently selected for
+inline isa active_isa() throw()
+{
+    return detail::active_isa_holder().load(std::memory_order_relaxed);
+}
+
+// Pins the kernels to the instruction set for benchmarking and debugging, the unsupported instruction sets are
+// lowered to the supported one. Returns the instruction set which will be actually used.
+inline isa set_active_isa(isa const value) throw()
+{
+    auto const res = detail::min_isa(value, supported_isa());
+    detail::active_isa_holder().store(res, std::memory_order_relaxed);
+    return res;
+}
+
+namespace detail {
+
+// The kernel family is the class template `Impl<isa>` with the static member function template `run<Ts...>`. The
+// level which is not specialized should inherit the previous one, see `kernel_fallback`.
+template<
+    typename Fn,
+    template<isa> class Impl,
+    typename... Ts>
+Fn dispatch() throw()
+{
+    static Fn const kernels[isa_count] =
+    {
+        &Impl<isa::scalar>::template run<Ts...>,
+        &Impl<isa::sse2  >::template run<Ts...>,
+        &Impl<isa::avx2  >::template run<Ts...>,
+        &Impl<isa::avx512>::template run<Ts...>
+    };
+    return kernels[static_cast<size_t>(active_isa())];
+}
+
+template<isa level>
+struct kernel_fallback final
+{
+    static isa const value = static_cast<isa>(static_cast<int>(level) - 1);
+};
+
+}}}
@@ -0,0 +1,112 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ww898 {
+namespace utf {
+
+enum struct utf_error
+{
+    none,
+    invalid_lead,       // The first char of the symbol is incorrect, or the low utf16 surrogate is met first
+    invalid_slave,      // The slave char or the low utf16 surrogate is expected
+    not_enough_input,   // The input ends in the middle of the symbol
+    invalid_code_point, // The code point is out of the range of the input or the output encoding
+};
+
+static uint32_t const replacement_code_point = 0xFFFD;
+
+// Error policies of `conv`, `convz` and `size`:
+//   error_throw   - `std::runtime_error` is thrown, the default
+//   error_replace - every malformed symbol is converted to U+FFFD, or to '?' when the output can not encode U+FFFD
+//   error_skip    - every malformed symbol is dropped
+//   error_stop    - the conversion stops on the malformed symbol and reports it in the status
+// All the policies except `error_throw` never throw by themselves.
+struct error_throw final {};
+struct error_replace final {};
+struct error_skip final {};
+struct error_stop final {};
+
+template<typename Policy>
+struct is_error_policy final : std::integral_constant<bool,
+    std::is_same<Policy, error_throw>::value ||
+    std::is_same<Policy, error_replace>::value ||
+    std::is_same<Policy, error_skip>::value ||
+    std::is_same<Policy, error_stop>::value> {};
+
+// The result of `conv` and `convz` with `error_stop`. `in` points to the malformed symbol, or to the end of the input
+// when `error` is `utf_error::none`.
+template<
+    typename It,
+    typename Oit>
+struct conv_status final
+{
+    It in;
+    Oit out;
+    utf_error error;
+};
+
+// The result of `size` with `error_stop`
+template<typename It>
+struct size_status final
+{
+    It in;
+    size_t size;
+    utf_error error;
+};
+
+namespace detail {
+
+template<typename Policy>
+struct error_handler final {};
+
+template<>
+struct error_handler<error_replace> final
+{
+    static bool const stop = false;
+    static bool const replace = true;
+};
+
+template<>
+struct error_handler<error_skip> final
+{
+    static bool const stop = false;
+    static bool const replace = false;
+};
+
+template<>
+struct error_handler<error_stop> final
+{
+    static bool const stop = true;
+    static bool const replace = false;
+};
+
+}
+
+}}
@@ -0,0 +1,233 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_simd.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_validate.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+enum struct cp_index_impl { normal, contiguous };
+
+template<
+    typename Utf,
+    typename Ch,
+    cp_index_impl>
+struct cp_index_builder final
+{
+    template<typename MarkFn>
+    static size_t apply(Ch const * const first, Ch const * const eit, size_t const step, MarkFn && mark_fn)
+    {
+        size_t total_cp = 0;
+        auto it = first;
+        auto const read_fn = [&it, eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            };
+        while (it != eit)
+        {
+            if (total_cp % step == 0)
+                mark_fn(it);
+            Utf::read(read_fn);
+            ++total_cp;
+        }
+        return total_cp;
+    }
+};
+
+// The next mark is at least `next_mark - total_cp` units ahead, so that many units of the valid prefix found by the
+// validator are counted in bulk without looking for the leads. The distance shrinks with every round and the last
+// units before the mark are scanned one by one. The rest is read by the codec symbol by symbol, so the errors are the
+// same as for `conv`.
+template<
+    typename Utf,
+    typename Ch>
+struct cp_index_builder<Utf, Ch, cp_index_impl::contiguous> final
+{
+    static size_t const min_bulk_size = 32;
+
+    template<typename MarkFn>
+    static size_t apply(Ch const * const first, Ch const * const eit, size_t const step, MarkFn && mark_fn)
+    {
+        auto const kernel = block_size<Utf, utf32>::template kernel<Ch, utf32>();
+        size_t total_cp = 0;
+        size_t next_mark = 0;
+        auto it = first;
+        auto const read_fn = [&it, eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            };
+        while (it != eit)
+        {
+            auto const valid_eit = validator<Utf>::skip(it, eit);
+            while (it != valid_eit)
+            {
+                auto const distance = next_mark - total_cp;
+                if (distance >= min_bulk_size)
+                {
+                    auto const piece = it;
+                    total_cp += kernel(it, it + std::min<size_t>(distance, static_cast<size_t>(valid_eit - it)));
+                    if (it != piece)
+                        continue;
+                }
+                if (cp_lead<Utf>::test(*it))
+                {
+                    if (total_cp == next_mark)
+                    {
+                        mark_fn(it);
+                        next_mark += step;
+                    }
+                    ++total_cp;
+                }
+                ++it;
+            }
+            if (it != eit)
+            {
+                if (total_cp == next_mark)
+                {
+                    mark_fn(it);
+                    next_mark += step;
+                }
+                Utf::read(read_fn);
+                ++total_cp;
+            }
+        }
+        return total_cp;
+    }
+};
+
+}
+
+static size_t const default_cp_index_step = 128;
+
+// Maps the code point indexes to the unit offsets and back in the valid contiguous input. The unit offset of every
+// `step`-th code point is recorded in one pass, so every lookup is one table hit plus at most `step` symbols to walk.
+// The index keeps the pointer to the input, so the input should outlive it. The malformed input throws the same
+// errors as `conv`.
+template<
+    typename Utf,
+    typename Ch = typename Utf::char_type>
+class cp_index final
+{
+public:
+    cp_index(Ch const * const it, Ch const * const eit, size_t const step = default_cp_index_step)
+        : first_(it)
+        , units_(static_cast<size_t>(eit - it))
+        , step_(std::max<size_t>(step, 1))
+    {
+        marks_.reserve(units_ / step_ + 1);
+        size_ = detail::cp_index_builder<Utf, Ch,
+                detail::block_size<Utf, utf32>::enabled && detail::is_contiguous_input<Utf, Ch const *>::value
+                    ? detail::cp_index_impl::contiguous
+                    : detail::cp_index_impl::normal>::apply(it, eit, step_, [this] (Ch const * const mark)
+            {
+                marks_.push_back(static_cast<size_t>(mark - first_));
+            });
+        marks_.shrink_to_fit();
+    }
+
+    // The number of code points
+    size_t size() const throw() { return size_; }
+
+    // The number of units
+    size_t units() const throw() { return units_; }
+
+    size_t step() const throw() { return step_; }
+
+    // The number of the recorded offsets, every one takes `sizeof(size_t)`
+    size_t marks() const throw() { return marks_.size(); }
+
+    // Returns the unit offset of the code point, `units()` for `size()`
+    size_t offset(size_t const cp) const
+    {
+        if (cp >= size_)
+        {
+            if (cp == size_)
+                return units_;
+            throw std::out_of_range("The code point index is out of range");
+        }
+        auto it = first_ + marks_[cp / step_];
+        for (auto count = cp % step_; count-- > 0; )
+            it += Utf::char_size([it] { return *it; });
+        return static_cast<size_t>(it - first_);
+    }
+
+    // Returns the index of the code point which the unit belongs to, `size()` for `units()`
+    size_t code_point(size_t const offset) const
+    {
+        if (offset >= units_)
+        {
+            if (offset == units_)
+                return size_;
+            throw std::out_of_range("The unit offset is out of range");
+        }
+        auto const mark = std::upper_bound(marks_.cbegin(), marks_.cend(), offset) - 1;
+        auto cp = static_cast<size_t>(mark - marks_.cbegin()) * step_;
+        auto it = first_ + *mark;
+        for (auto const target = first_ + offset; ; ++cp)
+        {
+            it += Utf::char_size([it] { return *it; });
+            if (it > target)
+                return cp;
+        }
+    }
+
+private:
+    Ch const * first_;
+    size_t units_;
+    size_t size_;
+    size_t step_;
+    std::vector<size_t> marks_;
+};
+
+template<typename Ch>
+cp_index<utf_selector_t<Ch>, Ch> make_cp_index(Ch const * const it, Ch const * const eit, size_t const step = default_cp_index_step)
+{
+    return cp_index<utf_selector_t<Ch>, Ch>(it, eit, step);
+}
+
+template<typename Ch>
+cp_index<utf_selector_t<Ch>, Ch> make_cp_index(std::basic_string<Ch> const & str, size_t const step = default_cp_index_step)
+{
+    return cp_index<utf_selector_t<Ch>, Ch>(str.data(), str.data() + str.size(), step);
+}
+
+}}
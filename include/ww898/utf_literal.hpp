@@ -0,0 +1,159 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#if __cpp_lib_string_view >= 201606
+#include <string_view>
+#endif
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+template<typename Str>
+struct literal_writer;
+
+// Every input unit produces at most this number of the output units
+template<
+    typename Utf,
+    typename Outf>
+constexpr size_t literal_capacity(size_t const size)
+{
+    return size * ((Outf::max_supported_symbol_size + Utf::max_unicode_symbol_size - 1) / Utf::max_unicode_symbol_size);
+}
+
+}
+
+// The fixed capacity buffer of the transcoded literal. `size()` is the exact length, the chars are null terminated.
+template<
+    typename Och,
+    size_t Capacity>
+class literal_string final
+{
+public:
+    using value_type = Och;
+    using const_iterator = Och const *;
+
+    constexpr literal_string() throw()
+        : chars_()
+        , size_(0)
+    {
+    }
+
+    constexpr Och const * data() const throw() { return chars_; }
+    constexpr Och const * c_str() const throw() { return chars_; }
+    constexpr size_t size() const throw() { return size_; }
+    constexpr bool empty() const throw() { return !size_; }
+
+    constexpr Och const * begin() const throw() { return chars_; }
+    constexpr Och const * end() const throw() { return chars_ + size_; }
+
+    constexpr Och operator[](size_t const n) const throw() { return chars_[n]; }
+
+    std::basic_string<Och> str() const { return std::basic_string<Och>(chars_, size_); }
+
+#if __cpp_lib_string_view >= 201606
+    constexpr operator std::basic_string_view<Och>() const throw() { return std::basic_string_view<Och>(chars_, size_); }
+#endif
+
+private:
+    template<typename Str>
+    friend struct detail::literal_writer;
+
+    Och chars_[Capacity + 1];
+    size_t size_;
+};
+
+namespace detail {
+
+template<
+    typename Och,
+    typename Ch,
+    size_t N>
+using literal_type = literal_string<Och, literal_capacity<utf_selector_t<Ch>, utf_selector_t<Och>>(N - 1)>;
+
+template<
+    typename Utf,
+    typename Ch>
+struct literal_reader final
+{
+    Ch const * str;
+    size_t size;
+    size_t & pos;
+
+    WW898_UTF_CONSTEXPR14 typename Utf::char_type operator()() const
+    {
+        if (pos == size)
+            throw std::runtime_error("Not enough input");
+        return static_cast<typename Utf::char_type>(str[pos++]);
+    }
+};
+
+template<typename Str>
+struct literal_writer final
+{
+    Str & str;
+
+    template<typename Ch>
+    WW898_UTF_CONSTEXPR14 void operator()(Ch const ch) const
+    {
+        str.chars_[str.size_++] = static_cast<typename Str::value_type>(ch);
+    }
+};
+
+}
+
+// Transcodes the string literal to the `Och` chars with the codecs selected by the char types. Since C++14 the result
+// can be the constant expression, so the invalid literal is the compile error and nothing is converted at runtime:
+//   constexpr auto str = literal<char16_t>(u8"Привет");
+// Otherwise the malformed literal throws the same errors as `conv`.
+template<
+    typename Och,
+    typename Ch,
+    size_t N>
+WW898_UTF_CONSTEXPR14 detail::literal_type<Och, Ch, N> literal(Ch const (& str)[N])
+{
+    using utf_type = utf_selector_t<Ch>;
+    using outf_type = utf_selector_t<Och>;
+    using result_type = detail::literal_type<Och, Ch, N>;
+
+    result_type res;
+    size_t pos = 0;
+    while (pos != N - 1)
+        outf_type::write(
+            utf_type::read(detail::literal_reader<utf_type, Ch>{str, N - 1, pos}),
+            detail::literal_writer<result_type>{res});
+    return res;
+}
+
+}}
@@ -0,0 +1,187 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_simd.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_validate.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+// Moves forward over the UTF-8 input and keeps the number of UTF-16 units of the passed symbols. Both seeks stop on
+// the symbol boundary: the UTF-8 offset inside the symbol and the UTF-16 offset between the surrogates are rounded
+// down to the beginning of the symbol.
+template<typename Ch>
+class utf8_cursor final
+{
+public:
+    utf8_cursor(Ch const * const it, Ch const * const eit) throw()
+        : first_(it)
+        , it_(it)
+        , eit_(eit)
+        , valid_eit_(it)
+        , units_(0)
+    {
+    }
+
+    // Returns the UTF-16 offset of the UTF-8 offset
+    size_t seek_offset(size_t const offset)
+    {
+        if (offset > static_cast<size_t>(eit_ - first_))
+            throw std::out_of_range("The offset is out of range");
+        auto to = first_ + offset;
+        if (to < it_)
+            throw std::invalid_argument("The offsets should be sorted");
+        for (size_t n = 1; n < utf8::max_supported_symbol_size && to != it_ && to != eit_ && static_cast<uint8_t>(*to) >> 6 == 2; ++n)
+            --to;
+        units_ += converted_size<utf8, utf16>(it_, to);
+        it_ = to;
+        return units_;
+    }
+
+    // Returns the UTF-8 offset of the UTF-16 offset. A UTF-8 range has at most as many UTF-16 units as bytes, so the
+    // bytes up to the target are counted in bulk and the distance shrinks with every round. The input is validated
+    // ahead by blocks, so neither the next round nor the symbol the kernel stops on validates the same input again.
+    // The rest is read by the codec symbol by symbol, so the errors are the same as for `conv`.
+    size_t seek_units(size_t const target)
+    {
+        if (target < units_)
+            throw std::invalid_argument("The offsets should be sorted");
+        auto const read_fn = [this]
+            {
+                if (it_ == eit_)
+                    throw std::runtime_error("Not enough input");
+                return *it_++;
+            };
+        while (units_ < target)
+        {
+            if (it_ == eit_)
+                throw std::out_of_range("The offset is out of range");
+            if (bulk)
+            {
+                if (valid_eit_ <= it_)
+                    valid_eit_ = validator<utf8>::skip(it_, it_ + std::min(
+                        std::max<size_t>(target - units_, min_validate_size),
+                        static_cast<size_t>(eit_ - it_)));
+                auto piece_eit = it_ + std::min(target - units_, static_cast<size_t>(valid_eit_ - it_));
+                while (piece_eit != it_ && piece_eit != valid_eit_ && static_cast<uint8_t>(*piece_eit) >> 6 == 2)
+                    --piece_eit;
+                auto const piece = it_;
+                units_ += block_size<utf8, utf16>::template kernel<Ch, utf16>()(it_, piece_eit);
+                if (it_ != piece)
+                    continue;
+            }
+            auto const symbol = it_;
+            auto const size = units<utf16>(utf8::read(read_fn));
+            if (units_ + size > target)
+            {
+                it_ = symbol;
+                break;
+            }
+            units_ += size;
+        }
+        return static_cast<size_t>(it_ - first_);
+    }
+
+private:
+    static bool const bulk = block_size<utf8, utf16>::enabled && is_contiguous_input<utf8, Ch const *>::value;
+    static size_t const min_validate_size = 64 * 1024;
+
+    Ch const * first_;
+    Ch const * it_;
+    Ch const * eit_;
+    Ch const * valid_eit_;
+    size_t units_;
+};
+
+template<typename Ch>
+size_t const utf8_cursor<Ch>::min_validate_size;
+
+}
+
+// Returns the UTF-16 offset of the UTF-8 offset in the UTF-8 input. The offset inside the symbol is rounded down to the
+// beginning of the symbol.
+template<typename Ch>
+size_t utf8_to_utf16_offset(Ch const * const it, Ch const * const eit, size_t const offset)
+{
+    return detail::utf8_cursor<Ch>(it, eit).seek_offset(offset);
+}
+
+// Returns the UTF-8 offset of the UTF-16 offset in the UTF-8 input. The offset between the surrogates is rounded down
+// to the beginning of the symbol.
+template<typename Ch>
+size_t utf16_to_utf8_offset(Ch const * const it, Ch const * const eit, size_t const offset)
+{
+    return detail::utf8_cursor<Ch>(it, eit).seek_units(offset);
+}
+
+// Translates the sorted UTF-8 offsets in one pass
+template<
+    typename Ch,
+    typename It,
+    typename Oit>
+Oit utf8_to_utf16_offsets(Ch const * const it, Ch const * const eit, It first, It const last, Oit oit)
+{
+    detail::utf8_cursor<Ch> cursor(it, eit);
+    for (; first != last; ++first)
+        *oit++ = cursor.seek_offset(*first);
+    return oit;
+}
+
+// Translates the sorted UTF-16 offsets in one pass
+template<
+    typename Ch,
+    typename It,
+    typename Oit>
+Oit utf16_to_utf8_offsets(Ch const * const it, Ch const * const eit, It first, It const last, Oit oit)
+{
+    detail::utf8_cursor<Ch> cursor(it, eit);
+    for (; first != last; ++first)
+        *oit++ = cursor.seek_units(*first);
+    return oit;
+}
+
+template<typename Ch>
+size_t utf8_to_utf16_offset(std::basic_string<Ch> const & str, size_t const offset)
+{
+    return utf8_to_utf16_offset(str.data(), str.data() + str.size(), offset);
+}
+
+template<typename Ch>
+size_t utf16_to_utf8_offset(std::basic_string<Ch> const & str, size_t const offset)
+{
+    return utf16_to_utf8_offset(str.data(), str.data() + str.size(), offset);
+}
+
+}}
@@ -0,0 +1,343 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_converters.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ww898 {
+namespace utf {
+
+namespace detail {
+
+// The worker threads are started once and sleep between the jobs, one job runs at a time
+class thread_pool final
+{
+public:
+    explicit thread_pool(size_t const worker_count)
+        : stop_(false)
+        , generation_(0)
+        , job_workers_(0)
+        , active_(0)
+        , fn_(nullptr)
+        , call_(nullptr)
+        , task_count_(0)
+        , next_(0)
+    {
+        workers_.reserve(worker_count);
+        // The started workers are kept if the next one can not be started, the caller runs the tasks too anyway
+        try
+        {
+            for (size_t n = 0; n < worker_count; ++n)
+                workers_.emplace_back([this, n] { work(n); });
+        }
+        catch (std::system_error const &)
+        {
+        }
+    }
+
+    thread_pool(thread_pool const &) = delete;
+    thread_pool & operator=(thread_pool const &) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> const lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto & worker : workers_)
+            worker.join();
+    }
+
+    // The pool busy with the job of the other caller (or of the task itself) is not waited for, the tasks are run on
+    // the calling thread then
+    template<typename Fn>
+    void run(size_t const task_count, Fn const & fn)
+    {
+        std::unique_lock<std::mutex> const run_lock(run_mutex_, std::try_to_lock);
+        if (!run_lock.owns_lock() || task_count < 2 || workers_.empty())
+        {
+            for (size_t n = 0; n < task_count; ++n)
+                fn(n);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> const lock(mutex_);
+            fn_ = &fn;
+            call_ = [] (void const * const fn, size_t const n) { (*static_cast<Fn const *>(fn))(n); };
+            task_count_ = task_count;
+            next_ = 0;
+            job_workers_ = active_ = std::min(workers_.size(), task_count - 1);
+            ++generation_;
+        }
+        wake_.notify_all();
+        drain();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return !active_; });
+    }
+
+private:
+    void drain()
+    {
+        for (size_t n; (n = next_++) < task_count_; )
+            call_(fn_, n);
+    }
+
+    void work(size_t const index)
+    {
+        size_t generation = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            wake_.wait(lock, [this, &generation] { return stop_ || generation_ != generation; });
+            if (stop_)
+                return;
+            generation = generation_;
+            if (index >= job_workers_)
+                continue;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (!--active_)
+                done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_;
+    size_t generation_;
+    size_t job_workers_;
+    size_t active_;
+    void const * fn_;
+    void (* call_)(void const *, size_t);
+    size_t task_count_;
+    std::atomic<size_t> next_;
+};
+
+inline std::shared_ptr<thread_pool> const & default_thread_pool()
+{
+    static auto const pool = std::make_shared<thread_pool>(std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+    return pool;
+}
+
+}
+
+// The default executor of `parallel_conv`. Any executor should run `fn(n)` for every `n` in `[0‥task_count)` and
+// return when all the tasks are done, the tasks never throw. The threads are started once per pool, the default
+// constructed executors share the pool of `std::thread::hardware_concurrency()` threads.
+class thread_executor final
+{
+public:
+    thread_executor()
+        : pool_(detail::default_thread_pool())
+    {
+    }
+
+    explicit thread_executor(size_t const thread_count)
+        : pool_(std::make_shared<detail::thread_pool>(thread_count ? thread_count - 1 : 0))
+    {
+    }
+
+    template<typename Fn>
+    void operator()(size_t const task_count, Fn const & fn) const
+    {
+        pool_->run(task_count, fn);
+    }
+
+private:
+    std::shared_ptr<detail::thread_pool> pool_;
+};
+
+namespace detail {
+
+// Moves the chunk boundary forward to the beginning of the symbol. The malformed input can have no boundary nearby, so
+// at most `Utf::max_supported_symbol_size - 1` units are skipped.
+template<typename Utf>
+struct chunk_boundary final {};
+
+template<>
+struct chunk_boundary<utf8> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * it, Ch const * const eit) throw()
+    {
+        for (size_t n = 1; n < utf8::max_supported_symbol_size && it != eit && static_cast<uint8_t>(*it) >> 6 == 2; ++n)
+            ++it;
+        return it;
+    }
+};
+
+template<>
+struct chunk_boundary<utf8_dfa> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * const it, Ch const * const eit) throw()
+    {
+        return chunk_boundary<utf8>::find(it, eit);
+    }
+};
+
+template<>
+struct chunk_boundary<utf16> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * const it, Ch const * const eit) throw()
+    {
+        return it != eit && static_cast<uint16_t>(*it) >> 10 == 0x37 ? it + 1 : it;
+    }
+};
+
+template<>
+struct chunk_boundary<utf32> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * const it, Ch const *) throw()
+    {
+        return it;
+    }
+};
+
+template<>
+struct chunk_boundary<latin1> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * const it, Ch const *) throw()
+    {
+        return it;
+    }
+};
+
+template<>
+struct chunk_boundary<ascii> final
+{
+    template<typename Ch>
+    static Ch const * find(Ch const * const it, Ch const *) throw()
+    {
+        return it;
+    }
+};
+
+}
+
+static size_t const default_parallel_chunk_size = 1024 * 1024;
+
+// Converts the contiguous input by chunks in parallel and appends the result to the contiguous container, e.g.
+// `std::basic_string` or `std::vector`. The output sizes of the chunks are counted first, so every chunk is converted
+// right into its place. The chunks are split at the symbol boundaries, so exactly the same symbols as for `conv` are
+// valid. The input after the first chunk which fails is converted sequentially, so the error is always the first one
+// by the input position and exactly the same as `conv` throws. The container is left unchanged on error.
+template<
+    typename Utf,
+    typename Outf,
+    typename Ch,
+    typename Container,
+    typename Executor = thread_executor>
+void parallel_conv(
+    Ch const * const it,
+    Ch const * const eit,
+    Container & res,
+    Executor && executor = Executor(),
+    size_t const chunk_size = default_parallel_chunk_size)
+{
+    using och_type = typename Container::value_type;
+    static_assert(sizeof(och_type) == sizeof(typename Outf::char_type), "The container can not hold the output units");
+
+    auto const step = std::max<size_t>(chunk_size, 1);
+    std::vector<Ch const *> bounds(1, it);
+    while (static_cast<size_t>(eit - bounds.back()) > step)
+        bounds.push_back(detail::chunk_boundary<Utf>::find(bounds.back() + step, eit));
+    bounds.push_back(eit);
+    auto const chunk_count = bounds.size() - 1;
+
+    std::vector<size_t> sizes(chunk_count + 1);
+    std::vector<char> failed(chunk_count);
+    executor(chunk_count, [&bounds, &sizes, &failed] (size_t const n)
+        {
+            try
+            {
+                sizes[n + 1] = converted_size<Utf, Outf>(bounds[n], bounds[n + 1]);
+            }
+            catch (...)
+            {
+                failed[n] = 1;
+            }
+        });
+
+    auto const valid_count = static_cast<size_t>(std::find(failed.cbegin(), failed.cend(), 1) - failed.cbegin());
+    std::basic_string<och_type> tail;
+    conv<Utf, Outf>(bounds[valid_count], eit, std::back_inserter(tail));
+
+    for (size_t n = 0; n < valid_count; ++n)
+        sizes[n + 1] += sizes[n];
+    if (!sizes[valid_count] && tail.empty())
+        return;
+    auto const offset = res.size();
+    res.resize(offset + sizes[valid_count] + tail.size());
+    auto const output = &res[0] + offset;
+    executor(valid_count, [&bounds, &sizes, output] (size_t const n)
+        {
+            conv<Utf, Outf>(bounds[n], bounds[n + 1], output + sizes[n]);
+        });
+    std::copy(tail.cbegin(), tail.cend(), output + sizes[valid_count]);
+}
+
+template<
+    typename Och,
+    typename Ch,
+    typename Executor = thread_executor>
+std::basic_string<Och> parallel_conv(
+    std::basic_string<Ch> const & str,
+    Executor && executor = Executor(),
+    size_t const chunk_size = default_parallel_chunk_size)
+{
+    std::basic_string<Och> res;
+    parallel_conv<utf_selector_t<Ch>, utf_selector_t<Och>>(str.data(), str.data() + str.size(), res, std::forward<Executor>(executor), chunk_size);
+    return res;
+}
+
+}}
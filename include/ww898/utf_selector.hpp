@@ -25,30 +25,44 @@
 #pragma once
 
 #include <ww898/cp_utf8.hpp>
+#include <ww898/cp_utf8_dfa.hpp>
 #include <ww898/cp_utf16.hpp>
 #include <ww898/cp_utf32.hpp>
 #include <ww898/cp_utfw.hpp>
+#include <ww898/cp_utf_endian.hpp>
+#include <ww898/cp_latin1.hpp>
+#include <ww898/cp_ascii.hpp>
 
 namespace ww898 {
 namespace utf {
 namespace detail {
 
-template<typename Ch>
+template<
+    typename Ch,
+    typename Utf8>
 struct utf_selector final {};
 
-template<> struct utf_selector<         char> final { using type = utf8 ; };
-template<> struct utf_selector<unsigned char> final { using type = utf8 ; };
-template<> struct utf_selector<signed   char> final { using type = utf8 ; };
-template<> struct utf_selector<char16_t     > final { using type = utf16; };
-template<> struct utf_selector<char32_t     > final { using type = utf32; };
-template<> struct utf_selector<wchar_t      > final { using type = utfw ; };
+template<typename Utf8> struct utf_selector<         char, Utf8> final { using type = Utf8 ; };
+template<typename Utf8> struct utf_selector<unsigned char, Utf8> final { using type = Utf8 ; };
+template<typename Utf8> struct utf_selector<signed   char, Utf8> final { using type = Utf8 ; };
+template<typename Utf8> struct utf_selector<char16_t     , Utf8> final { using type = utf16; };
+template<typename Utf8> struct utf_selector<char32_t     , Utf8> final { using type = utf32; };
+template<typename Utf8> struct utf_selector<wchar_t      , Utf8> final { using type = utfw ; };
+#if defined(__cpp_char8_t)
+template<typename Utf8> struct utf_selector<char8_t      , Utf8> final { using type = Utf8 ; };
+#endif
 
 }
 
-template<typename Ch>
-using utf_selector = detail::utf_selector<typename std::decay<Ch>::type>;
+// `Utf8` is the codec of the 8-bit chars, e.g. `utf8_dfa`
+template<
+    typename Ch,
+    typename Utf8 = utf8>
+using utf_selector = detail::utf_selector<typename std::decay<Ch>::type, Utf8>;
 
-template<typename Ch>
-using utf_selector_t = typename utf_selector<Ch>::type;
+template<
+    typename Ch,
+    typename Utf8 = utf8>
+using utf_selector_t = typename utf_selector<Ch, Utf8>::type;
 
 }}
@@ -0,0 +1,1706 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_dispatch.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#if defined(WW898_UTF_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(WW898_UTF_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+#if defined(WW898_UTF_SSE2)
+
+template<size_t OchSize>
+struct ascii_store_sse2 final {};
+
+template<>
+struct ascii_store_sse2<1> final
+{
+    static void apply(__m128i const v, void * const oit) throw()
+    {
+        _mm_storeu_si128(static_cast<__m128i *>(oit), v);
+    }
+};
+
+template<>
+struct ascii_store_sse2<2> final
+{
+    static void apply(__m128i const v, void * const oit) throw()
+    {
+        auto const o = static_cast<__m128i *>(oit);
+        auto const zero = _mm_setzero_si128();
+        _mm_storeu_si128(o + 0, _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi8(v, zero));
+    }
+};
+
+template<>
+struct ascii_store_sse2<4> final
+{
+    static void apply(__m128i const v, void * const oit) throw()
+    {
+        auto const o = static_cast<__m128i *>(oit);
+        auto const zero = _mm_setzero_si128();
+        auto const lo = _mm_unpacklo_epi8(v, zero);
+        auto const hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi, zero));
+    }
+};
+
+#endif
+
+#if defined(WW898_UTF_AVX2)
+
+template<size_t OchSize>
+struct ascii_store_avx2 final {};
+
+template<>
+struct ascii_store_avx2<1> final
+{
+    WW898_UTF_TARGET_AVX2 static void apply(__m256i const v, void * const oit) throw()
+    {
+        _mm256_storeu_si256(static_cast<__m256i *>(oit), v);
+    }
+};
+
+template<>
+struct ascii_store_avx2<2> final
+{
+    WW898_UTF_TARGET_AVX2 static void apply(__m256i const v, void * const oit) throw()
+    {
+        auto const o = static_cast<__m256i *>(oit);
+        _mm256_storeu_si256(o + 0, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(o + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+};
+
+template<>
+struct ascii_store_avx2<4> final
+{
+    WW898_UTF_TARGET_AVX2 static void apply(__m256i const v, void * const oit) throw()
+    {
+        auto const o = static_cast<__m256i *>(oit);
+        auto const lo = _mm256_castsi256_si128(v);
+        auto const hi = _mm256_extracti128_si256(v, 1);
+        _mm256_storeu_si256(o + 0, _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256(o + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256(o + 2, _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256(o + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+    }
+};
+
+#endif
+
+#if defined(WW898_UTF_AVX512)
+
+// The wider output is converted straight from the input, the lane extractions are not needed
+template<size_t OchSize>
+struct ascii_store_avx512 final {};
+
+template<>
+struct ascii_store_avx512<1> final
+{
+    WW898_UTF_TARGET_AVX512 static void apply(__m512i const v, void const *, void * const oit) throw()
+    {
+        _mm512_storeu_si512(oit, v);
+    }
+};
+
+template<>
+struct ascii_store_avx512<2> final
+{
+    WW898_UTF_TARGET_AVX512 static void apply(__m512i, void const * const it, void * const oit) throw()
+    {
+        auto const i = static_cast<__m256i const *>(it);
+        auto const o = static_cast<__m512i *>(oit);
+        _mm512_storeu_si512(o + 0, _mm512_cvtepu8_epi16(_mm256_loadu_si256(i + 0)));
+        _mm512_storeu_si512(o + 1, _mm512_cvtepu8_epi16(_mm256_loadu_si256(i + 1)));
+    }
+};
+
+// The 32-bit output is bound by the stores, so the AVX2 widening is as fast here
+template<>
+struct ascii_store_avx512<4> final
+{
+    WW898_UTF_TARGET_AVX512 static void apply(__m512i, void const * const it, void * const oit) throw()
+    {
+        auto const i = static_cast<__m256i const *>(it);
+        auto const o = static_cast<__m256i *>(oit);
+        ascii_store_avx2<4>::apply(_mm256_loadu_si256(i + 0), o + 0);
+        ascii_store_avx2<4>::apply(_mm256_loadu_si256(i + 1), o + 4);
+    }
+};
+
+#endif
+
+// Copies the leading 7-bit code units with the zero extension
+template<isa level>
+struct ascii_widen : ascii_widen<kernel_fallback<level>::value> {};
+
+template<>
+struct ascii_widen<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        static_assert(sizeof(Ch) == 1, "The 8-bit input is expected");
+        for (; it != eit && static_cast<uint8_t>(*it) < 0x80; ++it, ++oit)
+            *oit = static_cast<Och>(*it);
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct ascii_widen<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 16; it += 16, oit += 16)
+        {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+            if (_mm_movemask_epi8(v))
+                break;
+            ascii_store_sse2<sizeof(Och)>::apply(v, oit);
+        }
+        ascii_widen<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct ascii_widen<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 32; it += 32, oit += 32)
+        {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+            if (_mm256_movemask_epi8(v))
+                break;
+            ascii_store_avx2<sizeof(Och)>::apply(v, oit);
+        }
+        ascii_widen<isa::sse2>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX512)
+template<>
+struct ascii_widen<isa::avx512>
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX512 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 64; it += 64, oit += 64)
+        {
+            auto const v = _mm512_loadu_si512(it);
+            if (_mm512_movepi8_mask(v))
+                break;
+            ascii_store_avx512<sizeof(Och)>::apply(v, it, oit);
+        }
+        ascii_widen<isa::avx2>::run(it, eit, oit);
+    }
+};
+#endif
+
+// Encodes the symbols which start before `end` to UTF-8, the surrogate pair can cross `end`. Returns false on the
+// symbol which should be handled by the scalar codecs.
+template<size_t ChSize>
+struct utf8_encode_scalar final {};
+
+template<>
+struct utf8_encode_scalar<2> final
+{
+    template<
+        typename Ch,
+        typename Och>
+    static bool run(Ch const * & it, Ch const * const end, Ch const * const eit, Och * & oit) throw()
+    {
+        while (it < end)
+        {
+            uint32_t cp = static_cast<uint16_t>(*it);
+            if (cp >> 11 == 0x1B)
+            {
+                if (cp > utf16::max_surrogate_high || eit - it < 2 || static_cast<uint16_t>(it[1]) >> 10 != 0x37)
+                    return false;
+                cp = (cp << 10) + static_cast<uint16_t>(it[1]) - 0x35FDC00;
+                it += 2;
+            }
+            else
+                ++it;
+            utf8::write_block(cp, oit);
+        }
+        return true;
+    }
+};
+
+template<>
+struct utf8_encode_scalar<4> final
+{
+    template<
+        typename Ch,
+        typename Och>
+    static bool run(Ch const * & it, Ch const * const end, Ch const *, Och * & oit) throw()
+    {
+        for (; it < end; ++it)
+        {
+            uint32_t const cp = static_cast<uint32_t>(*it);
+            if (cp >= 0x200000)
+                return false;
+            utf8::write_block(cp, oit);
+        }
+        return true;
+    }
+};
+
+// The shuffle masks which compact four 32-bit lanes `lead|t2|t1|t0` of 1‥4-byte symbols into UTF-8. The low and high
+// nibbles of the index are the low and high bits of `symbol size - 1` for every lane.
+struct utf8_compaction_table final
+{
+    uint8_t shuffle[256][16];
+    uint8_t size[256];
+};
+
+inline utf8_compaction_table make_utf8_compaction_table() throw()
+{
+    utf8_compaction_table table;
+    for (size_t index = 0; index < 256; ++index)
+    {
+        size_t size = 0;
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            auto const tail_size = (index >> lane & 1) | (index >> (lane + 4) & 1) << 1;
+            table.shuffle[index][size++] = static_cast<uint8_t>(4 * lane);
+            for (auto n = 4 - tail_size; n < 4; ++n)
+                table.shuffle[index][size++] = static_cast<uint8_t>(4 * lane + n);
+        }
+        table.size[index] = static_cast<uint8_t>(size);
+        for (auto n = size; n < 16; ++n)
+            table.shuffle[index][n] = 0x80;
+    }
+    return table;
+}
+
+inline utf8_compaction_table const & utf8_compaction() throw()
+{
+    static utf8_compaction_table const table = make_utf8_compaction_table();
+    return table;
+}
+
+#if defined(WW898_UTF_SSE2)
+
+// Narrows 16 units to 16 bytes when all of them are 7-bit
+template<size_t ChSize>
+struct ascii_narrow_sse2 final {};
+
+template<>
+struct ascii_narrow_sse2<2> final
+{
+    static bool apply(void const * const it, void * const oit) throw()
+    {
+        auto const i = static_cast<__m128i const *>(it);
+        auto const a = _mm_loadu_si128(i + 0);
+        auto const b = _mm_loadu_si128(i + 1);
+        auto const high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+            return false;
+        _mm_storeu_si128(static_cast<__m128i *>(oit), _mm_packus_epi16(a, b));
+        return true;
+    }
+};
+
+template<>
+struct ascii_narrow_sse2<4> final
+{
+    static bool apply(void const * const it, void * const oit) throw()
+    {
+        auto const i = static_cast<__m128i const *>(it);
+        auto const a = _mm_loadu_si128(i + 0);
+        auto const b = _mm_loadu_si128(i + 1);
+        auto const c = _mm_loadu_si128(i + 2);
+        auto const d = _mm_loadu_si128(i + 3);
+        auto const high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), _mm_set1_epi32(static_cast<int>(0xFFFFFF80)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF)
+            return false;
+        _mm_storeu_si128(static_cast<__m128i *>(oit), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        return true;
+    }
+};
+
+#endif
+
+#if defined(WW898_UTF_AVX2)
+
+template<size_t ChSize>
+struct ascii_narrow_avx2 final {};
+
+template<>
+struct ascii_narrow_avx2<2> final
+{
+    WW898_UTF_TARGET_AVX2 static bool apply(void const * const it, void * const oit) throw()
+    {
+        auto const v = _mm256_loadu_si256(static_cast<__m256i const *>(it));
+        if (!_mm256_testz_si256(v, _mm256_set1_epi16(static_cast<short>(0xFF80))))
+            return false;
+        _mm_storeu_si128(static_cast<__m128i *>(oit), _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+        return true;
+    }
+};
+
+template<>
+struct ascii_narrow_avx2<4> final
+{
+    WW898_UTF_TARGET_AVX2 static bool apply(void const * const it, void * const oit) throw()
+    {
+        auto const i = static_cast<__m256i const *>(it);
+        auto const a = _mm256_loadu_si256(i + 0);
+        auto const b = _mm256_loadu_si256(i + 1);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi32(static_cast<int>(0xFFFFFF80))))
+            return false;
+        // The packing works within the 128-bit lanes, so restore the order of the 64-bit quarters
+        auto const v = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm_storeu_si128(static_cast<__m128i *>(oit), _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+        return true;
+    }
+};
+
+// Compacts the UTF-8 symbols from the 32-bit lanes `lead|t2|t1|t0`, the `low` and `high` masks are the low and high
+// bits of `symbol size - 1` for the lanes. Writes up to 16 bytes past the symbols.
+template<typename Och>
+WW898_UTF_TARGET_AVX2 void utf8_compact_avx2(__m256i const bytes, __m256i const low, __m256i const high, utf8_compaction_table const & table, Och * & oit) throw()
+{
+    auto const low_bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(low)));
+    auto const high_bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(high)));
+    auto const index0 = (low_bits & 0x0F) | (high_bits & 0x0F) << 4;
+    auto const index1 = (low_bits & 0xF0) >> 4 | (high_bits & 0xF0);
+    auto const shuffle = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(table.shuffle[index0]))),
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(table.shuffle[index1])), 1);
+    auto const res = _mm256_shuffle_epi8(bytes, shuffle);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), _mm256_castsi256_si128(res));
+    oit += table.size[index0];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), _mm256_extracti128_si256(res, 1));
+    oit += table.size[index1];
+}
+
+// Encodes the block of 8 units, returns false if the block should be handled by the scalar code
+template<size_t ChSize>
+struct utf8_encode_avx2 final {};
+
+// Every surrogate emits a half of the 4-byte symbol, so all the lanes fit 1‥3 bytes:
+//   high 110110wwwwxxxxxx, wwww + 1 = uuuuu: 11110uuu 10uuxxxx
+//   low  110111yyyyzzzzzz:                   10xxyyyy 10zzzzzz
+// The high surrogate in the last lane is left for the next block.
+template<>
+struct utf8_encode_avx2<2> final
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static bool apply(Ch const * & it, Och * & oit, utf8_compaction_table const & table) throw()
+    {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        auto const tags = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFC00)));
+        auto const high16 = _mm_cmpeq_epi16(tags, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_high)));
+        auto const low16 = _mm_cmpeq_epi16(tags, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_low)));
+        if (_mm_movemask_epi8(_mm_xor_si128(_mm_slli_si128(high16, 2), low16)))
+            return false;
+        auto const cps = _mm256_cvtepu16_epi32(v);
+        auto const prev = _mm256_cvtepu16_epi32(_mm_slli_si128(v, 2));
+        auto const high = _mm256_cvtepi16_epi32(high16);
+        auto const low = _mm256_cvtepi16_epi32(low16);
+        auto const mask = _mm256_set1_epi32(0x3F);
+        auto const tag = _mm256_set1_epi32(0x80);
+        auto const size2 = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0x7F));
+        auto const size3 = _mm256_andnot_si256(_mm256_or_si256(high, low), _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0x7FF)));
+        auto const plane = _mm256_add_epi32(_mm256_and_si256(cps, _mm256_set1_epi32(0x3FF)), _mm256_set1_epi32(0x40));
+        auto lead = _mm256_blendv_epi8(cps, _mm256_or_si256(_mm256_srli_epi32(cps, 6), _mm256_set1_epi32(0xC0)), size2);
+        lead = _mm256_blendv_epi8(lead, _mm256_or_si256(_mm256_srli_epi32(cps, 12), _mm256_set1_epi32(0xE0)), size3);
+        lead = _mm256_blendv_epi8(lead, _mm256_or_si256(_mm256_srli_epi32(plane, 8), _mm256_set1_epi32(0xF0)), high);
+        lead = _mm256_blendv_epi8(lead, _mm256_or_si256(tag, _mm256_or_si256(
+            _mm256_slli_epi32(_mm256_and_si256(prev, _mm256_set1_epi32(0x03)), 4),
+            _mm256_and_si256(_mm256_srli_epi32(cps, 6), _mm256_set1_epi32(0x0F)))), low);
+        auto const t0 = _mm256_blendv_epi8(
+            _mm256_or_si256(_mm256_and_si256(cps, mask), tag),
+            _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(plane, 2), mask), tag), high);
+        auto const t1 = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(cps, 6), mask), tag);
+        auto const bytes = _mm256_or_si256(lead, _mm256_or_si256(_mm256_slli_epi32(t1, 16), _mm256_slli_epi32(t0, 24)));
+        utf8_compact_avx2(bytes, _mm256_xor_si256(size2, size3), size3, table, oit);
+        auto const last_high = static_cast<size_t>(static_cast<uint16_t>(it[7]) >> 10 == 0x36);
+        it += 8 - last_high;
+        oit -= 2 * last_high;
+        return true;
+    }
+};
+
+template<>
+struct utf8_encode_avx2<4> final
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static bool apply(Ch const * & it, Och * & oit, utf8_compaction_table const & table) throw()
+    {
+        auto const cps = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+        if (!_mm256_testz_si256(cps, _mm256_set1_epi32(static_cast<int>(0xFFE00000))))
+            return false;
+        auto const mask = _mm256_set1_epi32(0x3F);
+        auto const tag = _mm256_set1_epi32(0x80);
+        auto const size2 = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0x7F));
+        auto const size3 = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0x7FF));
+        auto const size4 = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0xFFFF));
+        auto lead = _mm256_blendv_epi8(cps, _mm256_or_si256(_mm256_srli_epi32(cps, 6), _mm256_set1_epi32(0xC0)), size2);
+        lead = _mm256_blendv_epi8(lead, _mm256_or_si256(_mm256_srli_epi32(cps, 12), _mm256_set1_epi32(0xE0)), size3);
+        lead = _mm256_blendv_epi8(lead, _mm256_or_si256(_mm256_srli_epi32(cps, 18), _mm256_set1_epi32(0xF0)), size4);
+        auto const t0 = _mm256_or_si256(_mm256_and_si256(cps, mask), tag);
+        auto const t1 = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(cps, 6), mask), tag);
+        auto const t2 = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(cps, 12), mask), tag);
+        auto const bytes = _mm256_or_si256(
+            _mm256_or_si256(lead, _mm256_slli_epi32(t2, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(t1, 16), _mm256_slli_epi32(t0, 24)));
+        utf8_compact_avx2(bytes, _mm256_xor_si256(_mm256_xor_si256(size2, size3), size4), size3, table, oit);
+        it += 8;
+        return true;
+    }
+};
+
+#endif
+
+// Encodes UTF-16/32 to UTF-8, the 7-bit blocks are narrowed and the rest is compacted from the 32-bit lanes with the
+// byte shuffle
+template<isa level>
+struct utf8_encode : utf8_encode<kernel_fallback<level>::value> {};
+
+template<>
+struct utf8_encode<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        utf8_encode_scalar<sizeof(Ch)>::run(it, eit, eit, oit);
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf8_encode<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        while (eit - it >= 16)
+            if (ascii_narrow_sse2<sizeof(Ch)>::apply(it, oit))
+            {
+                it += 16;
+                oit += 16;
+            }
+            else if (!utf8_encode_scalar<sizeof(Ch)>::run(it, it + 16, eit, oit))
+                return;
+        utf8_encode<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf8_encode<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const & table = utf8_compaction();
+        while (eit - it >= 16)
+        {
+            if (ascii_narrow_avx2<sizeof(Ch)>::apply(it, oit))
+            {
+                it += 16;
+                oit += 16;
+            }
+            else if (utf8_encode_avx2<sizeof(Ch)>::apply(it, oit, table))
+                continue;
+            else if (!utf8_encode_scalar<sizeof(Ch)>::run(it, it + 8, eit, oit))
+                return;
+        }
+        utf8_encode<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+// The indices of the 32-bit lanes selected by the 8-bit mask, moved to the beginning
+struct lane_compaction_table final
+{
+    uint8_t index[256][8];
+    uint8_t size[256];
+};
+
+inline lane_compaction_table make_lane_compaction_table() throw()
+{
+    lane_compaction_table table;
+    for (size_t mask = 0; mask < 256; ++mask)
+    {
+        size_t size = 0;
+        for (size_t lane = 0; lane < 8; ++lane)
+            if (mask >> lane & 1)
+                table.index[mask][size++] = static_cast<uint8_t>(lane);
+        table.size[mask] = static_cast<uint8_t>(size);
+        for (auto n = size; n < 8; ++n)
+            table.index[mask][n] = 0;
+    }
+    return table;
+}
+
+inline lane_compaction_table const & lane_compaction() throw()
+{
+    static lane_compaction_table const table = make_lane_compaction_table();
+    return table;
+}
+
+// The shuffle masks which compact four 32-bit lanes of UTF-16: the low unit of every lane and the high one of the
+// lanes selected by the 4-bit mask
+struct utf16_compaction_table final
+{
+    uint8_t shuffle[16][16];
+    uint8_t size[16];
+};
+
+inline utf16_compaction_table make_utf16_compaction_table() throw()
+{
+    utf16_compaction_table table;
+    for (size_t mask = 0; mask < 16; ++mask)
+    {
+        size_t size = 0;
+        for (size_t lane = 0; lane < 4; ++lane)
+            for (size_t n = 0; n < (mask >> lane & 1 ? 4u : 2u); ++n)
+                table.shuffle[mask][size++] = static_cast<uint8_t>(4 * lane + n);
+        table.size[mask] = static_cast<uint8_t>(size / 2);
+        for (auto n = size; n < 16; ++n)
+            table.shuffle[mask][n] = 0x80;
+    }
+    return table;
+}
+
+inline utf16_compaction_table const & utf16_compaction() throw()
+{
+    static utf16_compaction_table const table = make_utf16_compaction_table();
+    return table;
+}
+
+// Decodes the symbols which start before `end`, the surrogate pair can cross `end`. Returns false on the symbol which
+// should be handled by the scalar codecs.
+template<
+    typename Ch,
+    typename Och>
+bool utf16_decode_scalar(Ch const * & it, Ch const * const end, Ch const * const eit, Och * & oit) throw()
+{
+    while (it < end)
+    {
+        uint32_t const ch0 = static_cast<uint16_t>(*it);
+        if (ch0 >> 11 != 0x1B)
+        {
+            *oit++ = static_cast<Och>(ch0);
+            ++it;
+            continue;
+        }
+        if (ch0 > utf16::max_surrogate_high || eit - it < 2 || static_cast<uint16_t>(it[1]) >> 10 != 0x37)
+            return false;
+        *oit++ = static_cast<Och>((ch0 << 10) + static_cast<uint16_t>(it[1]) - 0x35FDC00);
+        it += 2;
+    }
+    return true;
+}
+
+// Decodes UTF-16 to UTF-32, the blocks without surrogates are widened and the pairs are combined in the lanes of the
+// high surrogates with the lanes of the low ones compacted away
+template<isa level>
+struct utf16_decode : utf16_decode<kernel_fallback<level>::value> {};
+
+template<>
+struct utf16_decode<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        utf16_decode_scalar(it, eit, eit, oit);
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf16_decode<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const mask = _mm_set1_epi16(static_cast<short>(0xF800));
+        auto const tag = _mm_set1_epi16(static_cast<short>(utf16::min_surrogate));
+        auto const zero = _mm_setzero_si128();
+        while (eit - it >= 8)
+        {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+            if (!_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), tag)))
+            {
+                auto const o = reinterpret_cast<__m128i *>(oit);
+                _mm_storeu_si128(o + 0, _mm_unpacklo_epi16(v, zero));
+                _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(v, zero));
+                it += 8;
+                oit += 8;
+            }
+            else if (!utf16_decode_scalar(it, it + 8, eit, oit))
+                return;
+        }
+        utf16_decode<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf16_decode<isa::avx2>
+{
+    // Writes up to 8 units past the symbols
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static bool combine(Ch const * & it, Och * & oit, lane_compaction_table const & table) throw()
+    {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        auto const tags = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFC00)));
+        auto const high16 = _mm_cmpeq_epi16(tags, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_high)));
+        auto const low16 = _mm_cmpeq_epi16(tags, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_low)));
+        if (_mm_movemask_epi8(_mm_xor_si128(_mm_slli_si128(high16, 2), low16)))
+            return false;
+        auto const cps = _mm256_cvtepu16_epi32(v);
+        auto const next = _mm256_cvtepu16_epi32(_mm_srli_si128(v, 2));
+        auto const pairs = _mm256_sub_epi32(_mm256_add_epi32(_mm256_slli_epi32(cps, 10), next), _mm256_set1_epi32(0x35FDC00));
+        auto const res = _mm256_blendv_epi8(cps, pairs, _mm256_cvtepi16_epi32(high16));
+        // The high surrogate in the last lane is left for the next block
+        auto const last_high = static_cast<size_t>(static_cast<uint16_t>(it[7]) >> 10 == 0x36);
+        auto const keep = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cvtepi16_epi32(low16)))) & (0xFFu >> last_high);
+        auto const index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(table.index[keep])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(oit), _mm256_permutevar8x32_epi32(res, index));
+        it += 8 - last_high;
+        oit += table.size[keep];
+        return true;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const & table = lane_compaction();
+        auto const mask = _mm256_set1_epi16(static_cast<short>(0xF800));
+        auto const tag = _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate));
+        while (eit - it >= 16)
+        {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+            if (!_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(v, mask), tag)))
+            {
+                auto const o = reinterpret_cast<__m256i *>(oit);
+                _mm256_storeu_si256(o + 0, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+                _mm256_storeu_si256(o + 1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+                it += 16;
+                oit += 16;
+            }
+            else if (!combine(it, oit, table) && !utf16_decode_scalar(it, it + 8, eit, oit))
+                return;
+        }
+        utf16_decode<isa::sse2>::run(it, eit, oit);
+    }
+};
+#endif
+
+// Encodes the symbols before `end` to UTF-16. Returns false on the code point which should be handled by the scalar
+// codecs.
+template<
+    typename Ch,
+    typename Och>
+bool utf16_encode_scalar(Ch const * & it, Ch const * const end, Och * & oit) throw()
+{
+    for (; it < end; ++it)
+    {
+        auto const cp = static_cast<uint32_t>(*it);
+        if (cp < utf16::min_surrogate || (cp > utf16::max_surrogate && cp < 0x10000))
+            *oit++ = static_cast<Och>(cp);
+        else if (cp >= 0x10000 && cp < 0x110000)
+        {
+            *oit++ = static_cast<Och>(0xD7C0 + (cp >> 10));
+            *oit++ = static_cast<Och>(0xDC00 + (cp & 0x3FF));
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+// Encodes UTF-32 to UTF-16. The code points in the surrogate range and above 0x10FFFF are found in the vectors and
+// left to the scalar codecs, so the same errors are reported.
+template<isa level>
+struct utf16_encode : utf16_encode<kernel_fallback<level>::value> {};
+
+template<>
+struct utf16_encode<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        utf16_encode_scalar(it, eit, oit);
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf16_encode<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const plane = _mm_set1_epi32(static_cast<int>(0xFFFF0000));
+        auto const mask = _mm_set1_epi32(0xF800);
+        auto const tag = _mm_set1_epi32(utf16::min_surrogate);
+        // There is no unsigned 32-bit pack in SSE2, so the values are packed with the bias
+        auto const bias32 = _mm_set1_epi32(0x8000);
+        auto const bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+        while (eit - it >= 8)
+        {
+            auto const i = reinterpret_cast<__m128i const *>(it);
+            auto const a = _mm_loadu_si128(i + 0);
+            auto const b = _mm_loadu_si128(i + 1);
+            auto const bmp = _mm_cmpeq_epi32(_mm_and_si128(_mm_or_si128(a, b), plane), _mm_setzero_si128());
+            auto const surrogate = _mm_or_si128(
+                _mm_cmpeq_epi32(_mm_and_si128(a, mask), tag),
+                _mm_cmpeq_epi32(_mm_and_si128(b, mask), tag));
+            if (_mm_movemask_epi8(bmp) == 0xFFFF && !_mm_movemask_epi8(surrogate))
+            {
+                auto const packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), _mm_add_epi16(packed, bias16));
+                it += 8;
+                oit += 8;
+            }
+            else if (!utf16_encode_scalar(it, it + 8, oit))
+                return;
+        }
+        utf16_encode<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf16_encode<isa::avx2>
+{
+    // The supplementary code points are split to the surrogate pairs in the lanes and the unused high halves of the
+    // other lanes are compacted away. Writes up to 8 units past the symbols.
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static bool split(Ch const * & it, Och * & oit, utf16_compaction_table const & table) throw()
+    {
+        auto const cps = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+        auto const surrogate = _mm256_cmpeq_epi32(_mm256_and_si256(cps, _mm256_set1_epi32(0xFFF800)), _mm256_set1_epi32(utf16::min_surrogate));
+        auto const too_large = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0x10FFFF));
+        auto const negative = _mm256_cmpgt_epi32(_mm256_setzero_si256(), cps);
+        if (!_mm256_testz_si256(_mm256_or_si256(surrogate, _mm256_or_si256(too_large, negative)), _mm256_set1_epi32(-1)))
+            return false;
+        auto const supplementary = _mm256_cmpgt_epi32(cps, _mm256_set1_epi32(0xFFFF));
+        auto const high = _mm256_add_epi32(_mm256_srli_epi32(cps, 10), _mm256_set1_epi32(0xD7C0));
+        auto const low = _mm256_or_si256(_mm256_and_si256(cps, _mm256_set1_epi32(0x3FF)), _mm256_set1_epi32(utf16::min_surrogate_low));
+        auto const units = _mm256_blendv_epi8(cps, _mm256_or_si256(high, _mm256_slli_epi32(low, 16)), supplementary);
+        auto const bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(supplementary)));
+        auto const shuffle = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(table.shuffle[bits & 0x0F]))),
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(table.shuffle[bits >> 4])), 1);
+        auto const res = _mm256_shuffle_epi8(units, shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), _mm256_castsi256_si128(res));
+        oit += table.size[bits & 0x0F];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), _mm256_extracti128_si256(res, 1));
+        oit += table.size[bits >> 4];
+        it += 8;
+        return true;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const & table = utf16_compaction();
+        auto const plane = _mm256_set1_epi32(static_cast<int>(0xFFFF0000));
+        auto const mask = _mm256_set1_epi32(0xF800);
+        auto const tag = _mm256_set1_epi32(utf16::min_surrogate);
+        while (eit - it >= 16)
+        {
+            auto const i = reinterpret_cast<__m256i const *>(it);
+            auto const a = _mm256_loadu_si256(i + 0);
+            auto const b = _mm256_loadu_si256(i + 1);
+            auto const surrogate = _mm256_or_si256(
+                _mm256_cmpeq_epi32(_mm256_and_si256(a, mask), tag),
+                _mm256_cmpeq_epi32(_mm256_and_si256(b, mask), tag));
+            if (_mm256_testz_si256(_mm256_or_si256(a, b), plane) && _mm256_testz_si256(surrogate, surrogate))
+            {
+                // The packing works within the 128-bit lanes, so restore the order of the 64-bit quarters
+                auto const packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(oit), packed);
+                it += 16;
+                oit += 16;
+            }
+            else if (!split(it, oit, table) && !utf16_encode_scalar(it, it + 8, oit))
+                return;
+        }
+        utf16_encode<isa::sse2>::run(it, eit, oit);
+    }
+};
+#endif
+
+// Zero-extends every 8-bit code unit
+template<isa level>
+struct latin1_widen : latin1_widen<kernel_fallback<level>::value> {};
+
+template<>
+struct latin1_widen<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; it != eit; ++it, ++oit)
+            *oit = static_cast<Och>(static_cast<uint8_t>(*it));
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct latin1_widen<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 16; it += 16, oit += 16)
+            ascii_store_sse2<sizeof(Och)>::apply(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it)), oit);
+        latin1_widen<isa::scalar>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct latin1_widen<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 32; it += 32, oit += 32)
+            ascii_store_avx2<sizeof(Och)>::apply(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it)), oit);
+        latin1_widen<isa::sse2>::run(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX512)
+template<>
+struct latin1_widen<isa::avx512>
+{
+    template<
+        typename Ch,
+        typename Och>
+    WW898_UTF_TARGET_AVX512 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        for (; eit - it >= 64; it += 64, oit += 64)
+            ascii_store_avx512<sizeof(Och)>::apply(_mm512_loadu_si512(it), it, oit);
+        latin1_widen<isa::avx2>::run(it, eit, oit);
+    }
+};
+#endif
+
+// Encodes Latin-1 to UTF-8, the 7-bit runs are copied by the blocks and the upper half is split to the two bytes
+template<isa level>
+struct latin1_encode
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        while (it != eit)
+        {
+            ascii_widen<level>::run(it, eit, oit);
+            for (; it != eit && static_cast<uint8_t>(*it) >= 0x80; ++it)
+            {
+                uint8_t const ch = *it;
+                *oit++ = static_cast<Och>(0xC0 | ch >> 6);
+                *oit++ = static_cast<Och>(0x80 | (ch & 0x3F));
+            }
+        }
+    }
+};
+
+// Decodes UTF-8 to Latin-1, the 7-bit runs are copied by the blocks and the two byte symbols [0x80‥0xFF] are joined.
+// Stops on any other symbol, it is either out of the Latin-1 range or malformed.
+template<isa level>
+struct latin1_narrow
+{
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        while (it != eit)
+        {
+            ascii_widen<level>::run(it, eit, oit);
+            if (eit - it < 2)
+                return;
+            uint8_t const ch0 = it[0];
+            uint8_t const ch1 = it[1];
+            if ((ch0 & 0xFE) != 0xC2 || ch1 >> 6 != 2)
+                return;
+            *oit++ = static_cast<Och>((ch0 & 0x1F) << 6 | (ch1 & 0x3F));
+            it += 2;
+        }
+    }
+};
+
+// The unit which can not be converted between the byte orders alone: any UTF-16 surrogate or too large UTF-32 char
+template<size_t ChSize>
+struct swap_special final {};
+
+template<>
+struct swap_special<2> final
+{
+    static bool test(uint16_t const ch) throw() { return ch >> 11 == 0x1B; }
+};
+
+template<>
+struct swap_special<4> final
+{
+    static bool test(uint32_t const ch) throw() { return ch >= 0x80000000; }
+};
+
+// Which side of the swap is native and should be checked for the special units
+enum struct swap_check { none, input, output };
+
+#if defined(WW898_UTF_SSE2)
+
+template<size_t ChSize>
+struct byte_swap_sse2 final {};
+
+template<>
+struct byte_swap_sse2<2> final
+{
+    static __m128i apply(__m128i const v) throw()
+    {
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+
+    static bool special(__m128i const v) throw()
+    {
+        auto const tag = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xF800)));
+        return _mm_movemask_epi8(_mm_cmpeq_epi16(tag, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate)))) != 0;
+    }
+};
+
+template<>
+struct byte_swap_sse2<4> final
+{
+    static __m128i apply(__m128i const v) throw()
+    {
+        auto const swapped = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(swapped, 0xB1), 0xB1);
+    }
+
+    static bool special(__m128i const v) throw()
+    {
+        return _mm_movemask_ps(_mm_castsi128_ps(v)) != 0;
+    }
+};
+
+#endif
+
+#if defined(WW898_UTF_AVX2)
+
+template<size_t ChSize>
+struct byte_swap_avx2 final {};
+
+template<>
+struct byte_swap_avx2<2> final
+{
+    WW898_UTF_TARGET_AVX2 static __m256i apply(__m256i const v) throw()
+    {
+        return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+    }
+
+    WW898_UTF_TARGET_AVX2 static bool special(__m256i const v) throw()
+    {
+        auto const tag = _mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xF800)));
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi16(tag, _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate)))) != 0;
+    }
+};
+
+template<>
+struct byte_swap_avx2<4> final
+{
+    WW898_UTF_TARGET_AVX2 static __m256i apply(__m256i const v) throw()
+    {
+        return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    }
+
+    WW898_UTF_TARGET_AVX2 static bool special(__m256i const v) throw()
+    {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(v)) != 0;
+    }
+};
+
+#endif
+
+// Copies the 16/32-bit units with the byte order reversed, the checked copy stops before the first special unit
+template<isa level>
+struct byte_swap_units : byte_swap_units<kernel_fallback<level>::value> {};
+
+template<>
+struct byte_swap_units<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Och,
+        typename Check>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        using unit_type = typename byte_swap<sizeof(Ch)>::type;
+        for (; it != eit; ++it, ++oit)
+        {
+            unit_type const ch = static_cast<unit_type>(*it);
+            unit_type const res = byte_swap<sizeof(Ch)>::apply(ch);
+            if (Check::value != swap_check::none && swap_special<sizeof(Ch)>::test(Check::value == swap_check::input ? ch : res))
+                break;
+            *oit = static_cast<Och>(res);
+        }
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct byte_swap_units<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Och,
+        typename Check>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        using ops = byte_swap_sse2<sizeof(Ch)>;
+        static size_t const block = 16 / sizeof(Ch);
+        for (; static_cast<size_t>(eit - it) >= block; it += block, oit += block)
+        {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+            auto const res = ops::apply(v);
+            if (Check::value != swap_check::none && ops::special(Check::value == swap_check::input ? v : res))
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(oit), res);
+        }
+        byte_swap_units<isa::scalar>::run<Ch, Och, Check>(it, eit, oit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct byte_swap_units<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Och,
+        typename Check>
+    WW898_UTF_TARGET_AVX2 static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        using ops = byte_swap_avx2<sizeof(Ch)>;
+        static size_t const block = 32 / sizeof(Ch);
+        for (; static_cast<size_t>(eit - it) >= block; it += block, oit += block)
+        {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+            auto const res = ops::apply(v);
+            if (Check::value != swap_check::none && ops::special(Check::value == swap_check::input ? v : res))
+                break;
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(oit), res);
+        }
+        byte_swap_units<isa::sse2>::run<Ch, Och, Check>(it, eit, oit);
+    }
+};
+#endif
+
+template<
+    typename Ch,
+    typename Och>
+using block_kernel = void (*)(Ch const * &, Ch const *, Och * &);
+
+template<
+    typename Utf,
+    typename It>
+struct is_contiguous_input final : std::integral_constant<bool,
+    std::is_pointer<It>::value &&
+    std::is_integral<typename std::remove_pointer<It>::type>::value &&
+    sizeof(typename std::remove_pointer<It>::type) == sizeof(typename Utf::char_type)> {};
+
+// The block conversion kernel consumes the longest input prefix it is able to convert in bulk and leaves the rest
+// (including any malformed sequence) to the scalar codecs. `accepts` may peek up to `Utf::max_supported_symbol_size`
+// units and guarantees that at least one unit will be consumed. The output should hold `max_ratio` units per every
+// input unit plus `overrun` units the kernel is allowed to write past the converted symbols.
+#if defined(WW898_UTF_SSE2)
+static bool const simd_enabled = true;
+#else
+// The scalar kernels alone are not faster than the per-symbol conversion
+static bool const simd_enabled = false;
+#endif
+
+template<
+    typename Utf,
+    typename Outf>
+struct block_conv final
+{
+    static bool const enabled = false;
+};
+
+struct utf8_ascii_block_conv
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = 0;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        return static_cast<uint8_t>(it[0]) < 0x80 && static_cast<uint8_t>(it[1]) < 0x80;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, ascii_widen, Ch, Och>();
+    }
+};
+
+template<> struct block_conv<utf8, utf16> final : utf8_ascii_block_conv {};
+template<> struct block_conv<utf8, utf32> final : utf8_ascii_block_conv {};
+
+// The automaton stores the units of every byte and moves the output forward only when the symbol is complete, so the
+// byte loop has no branches on the symbol boundaries
+template<typename Outf>
+struct utf8_dfa_store final {};
+
+template<>
+struct utf8_dfa_store<utf16> final
+{
+    static size_t const overrun = 2;
+
+    template<typename Och>
+    static bool apply(uint32_t const cp, bool const complete, Och * & oit) throw()
+    {
+        bool const invalid = (cp > 0x10FFFF) | (cp - 0xD800 < 0x800);
+        if (complete & invalid)
+            return false;
+        bool const pair = cp > 0xFFFF;
+        oit[0] = static_cast<Och>(pair ? 0xD7C0 + (cp >> 10) : cp);
+        oit[1] = static_cast<Och>(0xDC00 + (cp & 0x3FF));
+        oit += complete + (complete & pair);
+        return true;
+    }
+};
+
+template<>
+struct utf8_dfa_store<utf32> final
+{
+    static size_t const overrun = 1;
+
+    template<typename Och>
+    static bool apply(uint32_t const cp, bool const complete, Och * & oit) throw()
+    {
+        *oit = static_cast<Och>(cp);
+        oit += complete;
+        return true;
+    }
+};
+
+// Runs the automaton up to the first malformed symbol, the incomplete symbol at the end or the code point which `Outf`
+// can not encode. The ASCII runs of 8 bytes and longer are widened by the ASCII kernel.
+template<typename Outf>
+struct utf8_dfa_decode final
+{
+    static size_t const block_size = 16;
+
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        using tables = utf8_dfa_tables<>;
+        auto const widen = dispatch<block_kernel<Ch, Och>, ascii_widen, Ch, Och>();
+        // The positions never escape, so they stay in the registers
+        auto symbol = it;
+        auto cur = it;
+        auto out = oit;
+        // Only the low 6 bits are the state, so the shift is the only operation which depends on the previous byte
+        uint64_t state = tables::accept;
+        uint32_t cp = 0;
+        bool failed = false;
+        while (!failed && cur != eit)
+        {
+            if ((state & 0x3F) == tables::accept && eit - cur >= 8 && is_ascii8(cur))
+            {
+                auto ascii_it = cur;
+                auto ascii_oit = out;
+                widen(ascii_it, eit, ascii_oit);
+                symbol = cur = ascii_it;
+                out = ascii_oit;
+                continue;
+            }
+            auto const block_eit = static_cast<size_t>(eit - cur) > block_size ? cur + block_size : eit;
+            while (cur != block_eit)
+            {
+                uint8_t const ch = *cur++;
+                auto const row = tables::row(ch);
+                cp = cp << 6 | tables::payload(row, ch);
+                state = row >> (state & 0x3F);
+                auto const current = static_cast<uint32_t>(state) & 0x3F;
+                bool const complete = current == tables::accept;
+                if (current == tables::reject || !utf8_dfa_store<Outf>::apply(cp, complete, out))
+                {
+                    failed = true;
+                    break;
+                }
+                symbol = complete ? cur : symbol;
+                cp = complete ? 0 : cp;
+            }
+        }
+        it = symbol;
+        oit = out;
+    }
+
+private:
+    template<typename Ch>
+    static bool is_ascii8(Ch const * const it) throw()
+    {
+        uint64_t word;
+        std::memcpy(&word, it, sizeof(word));
+        return (word & UINT64_C(0x8080808080808080)) == 0;
+    }
+};
+
+// The automaton is the codec's own bulk decoder, so it is used with no SIMD as well
+template<typename Outf>
+struct utf8_dfa_block_conv
+{
+    static bool const enabled = true;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = utf8_dfa_store<Outf>::overrun;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        auto next = it;
+        uint32_t cp = 0;
+        return utf8_dfa::decode(next, it + utf8_dfa::max_supported_symbol_size, cp) == utf_error::none && Outf::encodable(cp);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return &utf8_dfa_decode<Outf>::template run<Ch, Och>;
+    }
+};
+
+template<> struct block_conv<utf8_dfa, utf16> final : utf8_dfa_block_conv<utf16> {};
+template<> struct block_conv<utf8_dfa, utf32> final : utf8_dfa_block_conv<utf32> {};
+
+template<>
+struct block_conv<utf16, utf8> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 3;
+    static size_t const overrun = 16;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        return static_cast<uint16_t>(it[0]) >> 11 != 0x1B;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, utf8_encode, Ch, Och>();
+    }
+};
+
+template<>
+struct block_conv<utf32, utf8> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 4;
+    static size_t const overrun = 16;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        return static_cast<uint32_t>(it[0]) < 0x200000;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, utf8_encode, Ch, Och>();
+    }
+};
+
+template<>
+struct block_conv<utf16, utf32> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = 8;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        uint16_t const ch0 = it[0];
+        return ch0 >> 11 != 0x1B || (ch0 >> 10 == 0x36 && static_cast<uint16_t>(it[1]) >> 10 == 0x37);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, utf16_decode, Ch, Och>();
+    }
+};
+
+template<>
+struct block_conv<utf32, utf16> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 2;
+    static size_t const overrun = 8;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        uint32_t const cp = it[0];
+        return cp < utf16::min_surrogate || (cp > utf16::max_surrogate && cp < 0x110000);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, utf16_encode, Ch, Och>();
+    }
+};
+
+template<> struct block_conv<ascii , utf8  > final : utf8_ascii_block_conv {};
+template<> struct block_conv<ascii , utf16 > final : utf8_ascii_block_conv {};
+template<> struct block_conv<ascii , utf32 > final : utf8_ascii_block_conv {};
+template<> struct block_conv<ascii , latin1> final : utf8_ascii_block_conv {};
+template<> struct block_conv<utf8  , ascii > final : utf8_ascii_block_conv {};
+template<> struct block_conv<latin1, ascii > final : utf8_ascii_block_conv {};
+
+struct latin1_widen_block_conv
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = 0;
+
+    template<typename Ch>
+    static bool accepts(Ch const *) throw()
+    {
+        return true;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, latin1_widen, Ch, Och>();
+    }
+};
+
+template<> struct block_conv<latin1, utf16> final : latin1_widen_block_conv {};
+template<> struct block_conv<latin1, utf32> final : latin1_widen_block_conv {};
+
+template<>
+struct block_conv<latin1, utf8> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 2;
+    static size_t const overrun = 0;
+
+    template<typename Ch>
+    static bool accepts(Ch const *) throw()
+    {
+        return true;
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, latin1_encode, Ch, Och>();
+    }
+};
+
+template<>
+struct block_conv<utf8, latin1> final
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = 0;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        uint8_t const ch0 = it[0];
+        return ch0 < 0x80 || ((ch0 & 0xFE) == 0xC2 && static_cast<uint8_t>(it[1]) >> 6 == 2);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, latin1_narrow, Ch, Och>();
+    }
+};
+
+// Converts between the byte orders of the same codec. The surrogates and the too large UTF-32 chars are left to the
+// scalar codecs.
+template<swap_check check>
+struct byte_swap_block_conv
+{
+    static bool const enabled = simd_enabled;
+    static size_t const max_ratio = 1;
+    static size_t const overrun = 0;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        using unit_type = typename byte_swap<sizeof(Ch)>::type;
+        unit_type const ch = static_cast<unit_type>(it[0]);
+        return !swap_special<sizeof(Ch)>::test(check == swap_check::input ? ch : byte_swap<sizeof(Ch)>::apply(ch));
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return dispatch<block_kernel<Ch, Och>, byte_swap_units, Ch, Och, std::integral_constant<swap_check, check>>();
+    }
+};
+
+template<typename Ch>
+block_kernel<Ch, Ch> byte_swap_kernel() throw()
+{
+    return dispatch<block_kernel<Ch, Ch>, byte_swap_units, Ch, Ch, std::integral_constant<swap_check, swap_check::none>>();
+}
+
+// The foreign input is swapped by the blocks to the stack buffer which is converted by the native kernel, so the
+// input is read from memory only once
+template<
+    typename Utf,
+    typename Outf>
+struct swapped_input_block_conv
+{
+    using native = block_conv<Utf, Outf>;
+
+    static bool const enabled = native::enabled;
+    static size_t const max_ratio = native::max_ratio;
+    static size_t const overrun = native::overrun;
+
+    static size_t const buffer_size = 256;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        Ch buf[Utf::max_supported_symbol_size];
+        for (size_t n = 0; n < Utf::max_supported_symbol_size; ++n)
+            buf[n] = static_cast<Ch>(byte_swap<sizeof(Ch)>::apply(static_cast<typename byte_swap<sizeof(Ch)>::type>(it[n])));
+        return native::accepts(static_cast<Ch const *>(buf));
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        auto const swap = byte_swap_kernel<Ch>();
+        auto const convert = native::template kernel<Ch, Och>();
+        Ch buf[buffer_size];
+        while (it != eit)
+        {
+            auto const size = std::min<size_t>(static_cast<size_t>(eit - it), buffer_size);
+            auto sit = it;
+            auto sbuf = buf;
+            swap(sit, it + size, sbuf);
+            Ch const * bit = buf;
+            convert(bit, buf + size, oit);
+            it += bit - buf;
+            if (bit != buf + size)
+                return;
+        }
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return &run<Ch, Och>;
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf>
+size_t const swapped_input_block_conv<Utf, Outf>::buffer_size;
+
+// The native kernel output is swapped in place while it is still in the cache
+template<
+    typename Utf,
+    typename Outf>
+struct swapped_output_block_conv
+{
+    using native = block_conv<Utf, Outf>;
+
+    static bool const enabled = native::enabled;
+    static size_t const max_ratio = native::max_ratio;
+    static size_t const overrun = native::overrun;
+
+    template<typename Ch>
+    static bool accepts(Ch const * const it) throw()
+    {
+        return native::accepts(it);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static void run(Ch const * & it, Ch const * const eit, Och * & oit) throw()
+    {
+        Och * const first = oit;
+        native::template kernel<Ch, Och>()(it, eit, oit);
+        Och const * sit = first;
+        auto sout = first;
+        byte_swap_kernel<Och>()(sit, oit, sout);
+    }
+
+    template<
+        typename Ch,
+        typename Och>
+    static block_kernel<Ch, Och> kernel() throw()
+    {
+        return &run<Ch, Och>;
+    }
+};
+
+template<typename Utf> struct block_conv<utf_swapped<Utf>, Utf> final : byte_swap_block_conv<swap_check::output> {};
+template<typename Utf> struct block_conv<Utf, utf_swapped<Utf>> final : byte_swap_block_conv<swap_check::input > {};
+
+template<
+    typename Utf,
+    typename Outf>
+struct block_conv<utf_swapped<Utf>, Outf> final : swapped_input_block_conv<Utf, Outf> {};
+
+template<
+    typename Utf,
+    typename Outf>
+struct block_conv<Utf, utf_swapped<Outf>> final : swapped_output_block_conv<Utf, Outf> {};
+
+template<
+    typename Utf,
+    typename Outf>
+struct block_conv<utf_swapped<Utf>, utf_swapped<Outf>> final : swapped_input_block_conv<Utf, utf_swapped<Outf>> {};
+
+}}}
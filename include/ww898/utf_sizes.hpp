@@ -25,9 +25,15 @@
 #pragma once
 
 #include <ww898/utf_selector.hpp>
+#include <ww898/utf_simd.hpp>
+#include <ww898/utf_validate.hpp>
+#include <ww898/utf_dispatch.hpp>
+#include <ww898/utf_errors.hpp>
 #include <ww898/utf_config.hpp>
 
 #include <cstddef>
+#include <cstdint>
+#include <algorithm>
 #include <stdexcept>
 #include <type_traits>
 #include <iterator>
@@ -37,6 +43,14 @@
 #include <string_view>
 #endif
 
+#if defined(WW898_UTF_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(WW898_UTF_AVX2)
+#include <immintrin.h>
+#endif
+
 namespace ww898 {
 namespace utf {
 
@@ -48,21 +62,130 @@ size_t char_size(It it)
     return Utf::char_size([&it] { return *it; });
 }
 
+namespace detail {
+
+// Every code point of the valid input starts with the lead unit
+template<typename Utf>
+struct cp_lead final {};
+
+template<>
+struct cp_lead<utf8> final
+{
+    template<typename Ch>
+    static bool test(Ch const ch) throw() { return static_cast<uint8_t>(ch) >> 6 != 2; }
+};
+
+template<>
+struct cp_lead<utf8_dfa> final
+{
+    template<typename Ch>
+    static bool test(Ch const ch) throw() { return cp_lead<utf8>::test(ch); }
+};
+
+template<>
+struct cp_lead<utf16> final
+{
+    template<typename Ch>
+    static bool test(Ch const ch) throw() { return static_cast<uint16_t>(ch) >> 10 != 0x37; }
+};
+
+template<>
+struct cp_lead<utf32> final
+{
+    template<typename Ch>
+    static bool test(Ch) throw() { return true; }
+};
+
+template<>
+struct cp_lead<latin1> final
+{
+    template<typename Ch>
+    static bool test(Ch) throw() { return true; }
+};
+
+template<>
+struct cp_lead<ascii> final
+{
+    template<typename Ch>
+    static bool test(Ch) throw() { return true; }
+};
+
+template<typename Utf>
+struct cp_lead<utf_swapped<Utf>> final
+{
+    template<typename Ch>
+    static bool test(Ch const ch) throw() { return cp_lead<Utf>::test(utf_swapped<Utf>::swap(ch)); }
+};
+
+}
+
+// Returns the beginning of the symbol which ends at the position. At most `Utf::max_supported_symbol_size` units are
+// visited, the symbol is not validated.
 template<
     typename Utf,
     typename It>
-size_t size(It it)
+It prev_boundary(It const first, It pos)
 {
+    for (size_t n = 0; n < Utf::max_supported_symbol_size && pos != first; ++n)
+        if (detail::cp_lead<Utf>::test(*--pos))
+            break;
+    return pos;
+}
+
+namespace detail {
+
+template<
+    typename Policy,
+    typename It>
+struct size_result_selector final
+{
+    using type = size_t;
+
+    static type make(It const &, size_t const size, utf_error) { return size; }
+};
+
+template<typename It>
+struct size_result_selector<error_stop, It> final
+{
+    using type = size_status<It>;
+
+    static type make(It it, size_t const size, utf_error const error) { return {it, size, error}; }
+};
+
+// Unlike the `error_throw` version the slave chars are checked too, so the malformed symbols are counted as `conv`
+// converts them
+template<
+    typename Utf,
+    typename Policy,
+    typename It,
+    typename Eit>
+typename size_result_selector<Policy, It>::type policy_size(It it, Eit const eit)
+{
+    using result = size_result_selector<Policy, It>;
     size_t total_cp = 0;
-    while (*it)
+    while (it != eit)
     {
-        size_t size = Utf::char_size([&it] { return *it; });
-        while (++it, --size > 0)
-            if (!*it)
-                throw std::runtime_error("Not enough input for the null-terminated string");
-        ++total_cp;
+        auto const first = it;
+        uint32_t cp;
+        auto const error = Utf::decode(it, eit, cp);
+        if (error == utf_error::none || error_handler<Policy>::replace)
+            ++total_cp;
+        else if (error_handler<Policy>::stop)
+            return result::make(first, total_cp, error);
     }
-    return total_cp;
+    return result::make(it, total_cp, utf_error::none);
+}
+
+}
+
+template<
+    typename Utf,
+    typename Policy = error_throw,
+    typename It,
+    typename std::enable_if<!std::is_same<Policy, error_throw>::value && is_error_policy<Policy>::value, void *>::type = nullptr>
+typename detail::size_result_selector<Policy, It>::type size(It it)
+{
+    return detail::policy_size<Utf, Policy>(it, detail::null_terminator());
 }
 
 namespace detail {
@@ -97,22 +220,849 @@ struct next_strategy<It, iterator_impl::random_access> final
 
 template<
     typename Utf,
+    typename Policy = error_throw,
     typename It,
-    typename Eit>
-size_t size(It it, Eit const eit)
+    typename Eit,
+    typename std::enable_if<!std::is_same<Policy, error_throw>::value && is_error_policy<Policy>::value, void *>::type = nullptr>
+typename detail::size_result_selector<Policy, It>::type size(It it, Eit const eit)
 {
-    size_t total_cp = 0;
-    while (it != eit)
+    return detail::policy_size<Utf, Policy>(it, eit);
+}
+
+namespace detail {
+
+template<typename Outf>
+size_t units(uint32_t const cp)
+{
+    size_t res = 0;
+    Outf::write(cp, [&res] (typename Outf::char_type) { ++res; });
+    return res;
+}
+
+// The units kernels count the output units of the valid input prefix and stop on the symbol which can not be encoded
+// by `Outf`, so the scalar codecs report the error. The input is already checked by the validator.
+template<typename Ch>
+using units_kernel = size_t (*)(Ch const * &, Ch const *);
+
+// `F4 90‥BF` and the leads from 0xF5 start the symbols above 0x10FFFF and `ED A0‥BF` encodes the surrogates, which
+// UTF-16 can not take. `F0 80‥8F` is the overlong form of the BMP symbol, which takes one UTF-16 unit instead of two.
+// UTF-32 takes everything below 0x80000000.
+template<typename Outf>
+struct utf8_units_policy final {};
+
+template<>
+struct utf8_units_policy<utf16> final
+{
+    static uint8_t const wide_lead = 0xF0;
+    static uint8_t const stop_lead = 0xF5;
+    static bool const check_next = true;
+};
+
+template<>
+struct utf8_units_policy<utf32> final
+{
+    static uint8_t const wide_lead = 0xFF;
+    static uint8_t const stop_lead = 0xFF;
+    static bool const check_next = false;
+};
+
+template<isa level>
+struct utf8_units : utf8_units<kernel_fallback<level>::value> {};
+
+template<>
+struct utf8_units<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
     {
-        size_t const size = Utf::char_size([&it] { return *it; });
-        detail::next_strategy<
-            typename std::decay<It>::type,
-            std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<typename std::decay<It>::type>::iterator_category>::value
-                    ? detail::iterator_impl::random_access
-                    : detail::iterator_impl::forward>()(it, eit, size);
-        ++total_cp;
+        size_t res = 0;
+        for (; it != eit; ++it)
+        {
+            uint8_t const ch = *it;
+            if (ch >= utf8_units_policy<Outf>::stop_lead ||
+                (utf8_units_policy<Outf>::check_next && (
+                    (ch == 0xED && static_cast<uint8_t>(it[1]) >= 0xA0) ||
+                    (ch == 0xF0 && static_cast<uint8_t>(it[1]) < 0x90) ||
+                    (ch == 0xF4 && static_cast<uint8_t>(it[1]) >= 0x90))))
+                break;
+            res += static_cast<size_t>(ch >> 6 != 2) + static_cast<size_t>(ch >= utf8_units_policy<Outf>::wide_lead);
+        }
+        return res;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf8_units<isa::sse2>
+{
+    static __m128i ge(__m128i const v, uint8_t const min) throw()
+    {
+        return _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(static_cast<char>(min))), v);
+    }
+
+    template<typename Outf>
+    static bool stop(__m128i const v, uint8_t const * const it) throw()
+    {
+        auto res = ge(v, utf8_units_policy<Outf>::stop_lead);
+        if (utf8_units_policy<Outf>::check_next)
+        {
+            auto const next = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it + 1));
+            auto const next_ge_90 = ge(next, 0x90);
+            res = _mm_or_si128(res, _mm_or_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xED))), ge(next, 0xA0)),
+                _mm_or_si128(
+                    _mm_andnot_si128(next_ge_90, _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xF0)))),
+                    _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xF4))), next_ge_90))));
+        }
+        return _mm_movemask_epi8(res) != 0;
+    }
+
+    // The checks of the next byte peek one byte past the block
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it > 16)
+        {
+            // Every byte adds up to 2 to the 8-bit counters
+            auto const block_eit = it + 16 * std::min<ptrdiff_t>((eit - it - 1) / 16, 127);
+            auto acc = _mm_setzero_si128();
+            for (; it != block_eit; it += 16)
+            {
+                auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+                if (stop<Outf>(v, reinterpret_cast<uint8_t const *>(it)))
+                    break;
+                acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+                acc = _mm_sub_epi8(acc, ge(v, utf8_units_policy<Outf>::wide_lead));
+            }
+            auto const sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+            res += static_cast<size_t>(_mm_cvtsi128_si32(_mm_add_epi32(sum, _mm_srli_si128(sum, 8))));
+            if (it != block_eit)
+                break;
+        }
+        return res + utf8_units<isa::scalar>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf8_units<isa::avx2>
+{
+    WW898_UTF_TARGET_AVX2 static __m256i ge(__m256i const v, uint8_t const min) throw()
+    {
+        return _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(static_cast<char>(min))), v);
+    }
+
+    template<typename Outf>
+    WW898_UTF_TARGET_AVX2 static bool stop(__m256i const v, uint8_t const * const it) throw()
+    {
+        auto res = ge(v, utf8_units_policy<Outf>::stop_lead);
+        if (utf8_units_policy<Outf>::check_next)
+        {
+            auto const next = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it + 1));
+            auto const next_ge_90 = ge(next, 0x90);
+            res = _mm256_or_si256(res, _mm256_or_si256(
+                _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(0xED))), ge(next, 0xA0)),
+                _mm256_or_si256(
+                    _mm256_andnot_si256(next_ge_90, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(0xF0)))),
+                    _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(0xF4))), next_ge_90))));
+        }
+        return _mm256_movemask_epi8(res) != 0;
     }
-    return total_cp;
+
+    template<
+        typename Ch,
+        typename Outf>
+    WW898_UTF_TARGET_AVX2 static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it > 32)
+        {
+            auto const block_eit = it + 32 * std::min<ptrdiff_t>((eit - it - 1) / 32, 127);
+            auto acc = _mm256_setzero_si256();
+            for (; it != block_eit; it += 32)
+            {
+                auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+                if (stop<Outf>(v, reinterpret_cast<uint8_t const *>(it)))
+                    break;
+                acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65)));
+                acc = _mm256_sub_epi8(acc, ge(v, utf8_units_policy<Outf>::wide_lead));
+            }
+            auto const sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+            auto const sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            res += static_cast<size_t>(_mm_cvtsi128_si32(_mm_add_epi32(sum128, _mm_srli_si128(sum128, 8))));
+            if (it != block_eit)
+                break;
+        }
+        return res + utf8_units<isa::sse2>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+// The output units of the unit are `base` plus the sum of the masks, which are -1 when set:
+//   UTF-8:  3 - (u < 0x80) - (u < 0x800) - (u is surrogate), every surrogate is a half of the 4-byte symbol
+//   UTF-32: 1 - (u is low surrogate)
+template<typename Outf>
+struct utf16_units_policy final {};
+
+template<>
+struct utf16_units_policy<utf8> final
+{
+    static size_t const base = 3;
+
+    static size_t scalar(uint16_t const ch) throw()
+    {
+        return ch < 0x80 ? 1 : ch < 0x800 || ch >> 11 == 0x1B ? 2 : 3;
+    }
+
+#if defined(WW898_UTF_SSE2)
+    static __m128i masks(__m128i const v) throw()
+    {
+        auto const plane = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xF800)));
+        return _mm_add_epi16(
+            _mm_add_epi16(
+                _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128()),
+                _mm_cmpeq_epi16(plane, _mm_setzero_si128())),
+            _mm_cmpeq_epi16(plane, _mm_set1_epi16(static_cast<short>(utf16::min_surrogate))));
+    }
+#endif
+
+#if defined(WW898_UTF_AVX2)
+    WW898_UTF_TARGET_AVX2 static __m256i masks(__m256i const v) throw()
+    {
+        auto const plane = _mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xF800)));
+        return _mm256_add_epi16(
+            _mm256_add_epi16(
+                _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xFF80))), _mm256_setzero_si256()),
+                _mm256_cmpeq_epi16(plane, _mm256_setzero_si256())),
+            _mm256_cmpeq_epi16(plane, _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate))));
+    }
+#endif
+};
+
+template<>
+struct utf16_units_policy<utf32> final
+{
+    static size_t const base = 1;
+
+    static size_t scalar(uint16_t const ch) throw()
+    {
+        return ch >> 10 != 0x37 ? 1 : 0;
+    }
+
+#if defined(WW898_UTF_SSE2)
+    static __m128i masks(__m128i const v) throw()
+    {
+        return _mm_cmpeq_epi16(
+            _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFC00))),
+            _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_low)));
+    }
+#endif
+
+#if defined(WW898_UTF_AVX2)
+    WW898_UTF_TARGET_AVX2 static __m256i masks(__m256i const v) throw()
+    {
+        return _mm256_cmpeq_epi16(
+            _mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xFC00))),
+            _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate_low)));
+    }
+#endif
+};
+
+template<isa level>
+struct utf16_units : utf16_units<kernel_fallback<level>::value> {};
+
+template<>
+struct utf16_units<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        for (; it != eit; ++it)
+            res += utf16_units_policy<Outf>::scalar(static_cast<uint16_t>(*it));
+        return res;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf16_units<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it >= 8)
+        {
+            // Every unit adds down to -3 to the 16-bit counters
+            auto const first = it;
+            auto const block_eit = it + 8 * std::min<ptrdiff_t>((eit - it) / 8, 8192);
+            auto acc = _mm_setzero_si128();
+            for (; it != block_eit; it += 8)
+                acc = _mm_add_epi16(acc, utf16_units_policy<Outf>::masks(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it))));
+            auto sum = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+            res += utf16_units_policy<Outf>::base * static_cast<size_t>(it - first) + static_cast<ptrdiff_t>(_mm_cvtsi128_si32(sum));
+        }
+        return res + utf16_units<isa::scalar>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf16_units<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    WW898_UTF_TARGET_AVX2 static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it >= 16)
+        {
+            auto const first = it;
+            auto const block_eit = it + 16 * std::min<ptrdiff_t>((eit - it) / 16, 8192);
+            auto acc = _mm256_setzero_si256();
+            for (; it != block_eit; it += 16)
+                acc = _mm256_add_epi16(acc, utf16_units_policy<Outf>::masks(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it))));
+            auto const sum256 = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+            auto sum = _mm_add_epi32(_mm256_castsi256_si128(sum256), _mm256_extracti128_si256(sum256, 1));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+            res += utf16_units_policy<Outf>::base * static_cast<size_t>(it - first) + static_cast<ptrdiff_t>(_mm_cvtsi128_si32(sum));
+        }
+        return res + utf16_units<isa::sse2>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+// The output units of the code point are 1 minus the sum of the masks. UTF-8 takes all the code points below
+// 0x80000000 and UTF-16 stops on the surrogate range and above 0x10FFFF.
+template<typename Outf>
+struct utf32_units_policy final {};
+
+template<>
+struct utf32_units_policy<utf8> final
+{
+    static bool scalar(uint32_t const cp, size_t & res) throw()
+    {
+        res +=
+            cp < 0x80 ? 1 :
+            cp < 0x800 ? 2 :
+            cp < 0x10000 ? 3 :
+            cp < 0x200000 ? 4 :
+            cp < 0x4000000 ? 5 : 6;
+        return true;
+    }
+
+#if defined(WW898_UTF_SSE2)
+    static bool masks(__m128i const v, __m128i & res) throw()
+    {
+        res = _mm_add_epi32(
+            _mm_add_epi32(
+                _mm_add_epi32(_mm_cmpgt_epi32(v, _mm_set1_epi32(0x7F)), _mm_cmpgt_epi32(v, _mm_set1_epi32(0x7FF))),
+                _mm_add_epi32(_mm_cmpgt_epi32(v, _mm_set1_epi32(0xFFFF)), _mm_cmpgt_epi32(v, _mm_set1_epi32(0x1FFFFF)))),
+            _mm_cmpgt_epi32(v, _mm_set1_epi32(0x3FFFFFF)));
+        return true;
+    }
+#endif
+
+#if defined(WW898_UTF_AVX2)
+    WW898_UTF_TARGET_AVX2 static bool masks(__m256i const v, __m256i & res) throw()
+    {
+        res = _mm256_add_epi32(
+            _mm256_add_epi32(
+                _mm256_add_epi32(_mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x7F)), _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x7FF))),
+                _mm256_add_epi32(_mm256_cmpgt_epi32(v, _mm256_set1_epi32(0xFFFF)), _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x1FFFFF)))),
+            _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x3FFFFFF)));
+        return true;
+    }
+#endif
+};
+
+template<>
+struct utf32_units_policy<utf16> final
+{
+    static bool scalar(uint32_t const cp, size_t & res) throw()
+    {
+        if (cp >> 11 == 0x1B || cp >= 0x110000)
+            return false;
+        res += cp < 0x10000 ? 1 : 2;
+        return true;
+    }
+
+#if defined(WW898_UTF_SSE2)
+    static bool masks(__m128i const v, __m128i & res) throw()
+    {
+        auto const surrogate = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xFFFFF800))), _mm_set1_epi32(utf16::min_surrogate));
+        auto const too_large = _mm_cmpgt_epi32(v, _mm_set1_epi32(0x10FFFF));
+        if (_mm_movemask_epi8(_mm_or_si128(surrogate, too_large)))
+            return false;
+        res = _mm_cmpgt_epi32(v, _mm_set1_epi32(0xFFFF));
+        return true;
+    }
+#endif
+
+#if defined(WW898_UTF_AVX2)
+    WW898_UTF_TARGET_AVX2 static bool masks(__m256i const v, __m256i & res) throw()
+    {
+        auto const surrogate = _mm256_cmpeq_epi32(_mm256_and_si256(v, _mm256_set1_epi32(static_cast<int>(0xFFFFF800))), _mm256_set1_epi32(utf16::min_surrogate));
+        auto const too_large = _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x10FFFF));
+        if (_mm256_movemask_epi8(_mm256_or_si256(surrogate, too_large)))
+            return false;
+        res = _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0xFFFF));
+        return true;
+    }
+#endif
+};
+
+template<isa level>
+struct utf32_units : utf32_units<kernel_fallback<level>::value> {};
+
+template<>
+struct utf32_units<isa::scalar>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        for (; it != eit; ++it)
+            if (!utf32_units_policy<Outf>::scalar(static_cast<uint32_t>(*it), res))
+                break;
+        return res;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf32_units<isa::sse2>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it >= 4)
+        {
+            // Every unit adds up to 5 to the 32-bit counters
+            auto const first = it;
+            auto const block_eit = it + 4 * std::min<ptrdiff_t>((eit - it) / 4, 0x1000000);
+            auto acc = _mm_setzero_si128();
+            for (; it != block_eit; it += 4)
+            {
+                __m128i masks;
+                if (!utf32_units_policy<Outf>::masks(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it)), masks))
+                    break;
+                acc = _mm_sub_epi32(acc, masks);
+            }
+            acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+            acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+            res += static_cast<size_t>(it - first) + static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+            if (it != block_eit)
+                break;
+        }
+        return res + utf32_units<isa::scalar>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf32_units<isa::avx2>
+{
+    template<
+        typename Ch,
+        typename Outf>
+    WW898_UTF_TARGET_AVX2 static size_t run(Ch const * & it, Ch const * const eit) throw()
+    {
+        size_t res = 0;
+        while (eit - it >= 8)
+        {
+            auto const first = it;
+            auto const block_eit = it + 8 * std::min<ptrdiff_t>((eit - it) / 8, 0x1000000);
+            auto acc = _mm256_setzero_si256();
+            for (; it != block_eit; it += 8)
+            {
+                __m256i masks;
+                if (!utf32_units_policy<Outf>::masks(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it)), masks))
+                    break;
+                acc = _mm256_sub_epi32(acc, masks);
+            }
+            auto sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+            res += static_cast<size_t>(it - first) + static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+            if (it != block_eit)
+                break;
+        }
+        return res + utf32_units<isa::sse2>::run<Ch, Outf>(it, eit);
+    }
+};
+#endif
+
+template<
+    typename Utf,
+    typename Outf>
+struct block_size final
+{
+    static bool const enabled = false;
+};
+
+template<template<isa> class Impl>
+struct block_size_impl
+{
+    static bool const enabled = simd_enabled;
+
+    template<
+        typename Ch,
+        typename Outf>
+    static units_kernel<Ch> kernel() throw()
+    {
+        return dispatch<units_kernel<Ch>, Impl, Ch, Outf>();
+    }
+};
+
+template<> struct block_size<utf8 , utf16> final : block_size_impl<utf8_units > {};
+template<> struct block_size<utf8 , utf32> final : block_size_impl<utf8_units > {};
+template<> struct block_size<utf8_dfa, utf16> final : block_size_impl<utf8_units > {};
+template<> struct block_size<utf8_dfa, utf32> final : block_size_impl<utf8_units > {};
+template<> struct block_size<utf16, utf8 > final : block_size_impl<utf16_units> {};
+template<> struct block_size<utf16, utf32> final : block_size_impl<utf16_units> {};
+template<> struct block_size<utf32, utf8 > final : block_size_impl<utf32_units> {};
+template<> struct block_size<utf32, utf16> final : block_size_impl<utf32_units> {};
+
+enum struct size_impl { normal, contiguous };
+
+template<
+    typename Utf,
+    typename It,
+    size_impl>
+struct size_strategy final
+{
+    template<typename Eit>
+    size_t operator()(It it, Eit const eit) const
+    {
+        size_t total_cp = 0;
+        while (it != eit)
+        {
+            size_t const size = Utf::char_size([&it] { return *it; });
+            next_strategy<It,
+                std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value
+                    ? iterator_impl::random_access
+                    : iterator_impl::forward>()(it, eit, size);
+            ++total_cp;
+        }
+        return total_cp;
+    }
+};
+
+// The valid prefix found by the validator is counted in bulk: the UTF-8 lead bytes and the UTF-16 units which are not
+// the low surrogates. The rest is walked symbol by symbol, so the errors are the same as for the scalar version.
+template<
+    typename Utf,
+    typename It>
+struct size_strategy<Utf, It, size_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    template<typename NextFn>
+    static size_t apply(char_type const * it, char_type const * const eit, NextFn && next_fn)
+    {
+        auto const kernel = block_size<Utf, utf32>::template kernel<char_type, utf32>();
+        size_t total_cp = 0;
+        while (it != eit)
+        {
+            auto const valid_eit = validator<Utf>::skip(it, eit);
+            total_cp += kernel(it, valid_eit);
+            if (it != eit)
+            {
+                next_fn(it, eit, Utf::char_size([&it] { return *it; }));
+                ++total_cp;
+            }
+        }
+        return total_cp;
+    }
+
+    size_t operator()(char_type const * const it, char_type const * const eit) const
+    {
+        return apply(it, eit, next_strategy<char_type const *, iterator_impl::random_access>());
+    }
+};
+
+template<
+    typename Utf,
+    typename It,
+    size_impl>
+struct sizez_strategy final
+{
+    size_t operator()(It it) const
+    {
+        size_t total_cp = 0;
+        while (*it)
+        {
+            size_t size = Utf::char_size([&it] { return *it; });
+            while (++it, --size > 0)
+                if (!*it)
+                    throw std::runtime_error("Not enough input for the null-terminated string");
+            ++total_cp;
+        }
+        return total_cp;
+    }
+};
+
+template<
+    typename Utf,
+    typename It>
+struct sizez_strategy<Utf, It, size_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    size_t operator()(char_type const * const it) const
+    {
+        auto eit = it;
+        while (*eit)
+            ++eit;
+        return size_strategy<Utf, It, size_impl::contiguous>::apply(it, eit,
+            [] (char_type const * & it, char_type const * const eit, size_t size)
+            {
+                while (++it, --size > 0)
+                    if (it == eit)
+                        throw std::runtime_error("Not enough input for the null-terminated string");
+            });
+    }
+};
+
+template<
+    typename Utf,
+    typename It>
+struct size_selector final
+{
+    static size_impl const value =
+        block_size<Utf, utf32>::enabled && is_contiguous_input<Utf, It>::value
+            ? size_impl::contiguous
+            : size_impl::normal;
+};
+
+enum struct converted_size_impl { normal, contiguous, same };
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    converted_size_impl>
+struct converted_size_strategy final
+{
+    template<typename Eit>
+    size_t operator()(It it, Eit const eit) const
+    {
+        auto const read_fn = [&it, &eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            };
+        size_t res = 0;
+        while (it != eit)
+            res += units<Outf>(Utf::read(read_fn));
+        return res;
+    }
+};
+
+// The valid prefix found by the validator is counted in bulk and the rest is converted by the codecs symbol by symbol,
+// so the errors are the same as for `conv`
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+struct converted_size_strategy<Utf, Outf, It, converted_size_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    template<typename ReadFn>
+    static size_t apply(char_type const * & it, char_type const * const eit, ReadFn && read_fn)
+    {
+        auto const kernel = block_size<Utf, Outf>::template kernel<char_type, Outf>();
+        size_t res = 0;
+        while (it != eit)
+        {
+            auto const valid_eit = validator<Utf>::skip(it, eit);
+            while (res += kernel(it, valid_eit), it != valid_eit)
+                res += units<Outf>(Utf::read(read_fn));
+            if (it != eit)
+                res += units<Outf>(Utf::read(read_fn));
+        }
+        return res;
+    }
+
+    size_t operator()(char_type const * it, char_type const * const eit) const
+    {
+        return apply(it, eit, [&it, &eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            });
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+struct converted_size_strategy<Utf, Outf, It, converted_size_impl::same> final
+{
+    template<typename Eit>
+    size_t operator()(It it, Eit const eit) const
+    {
+        size_t res = 0;
+        for (; it != eit; ++it)
+            ++res;
+        return res;
+    }
+
+    size_t operator()(It const it, It const eit) const
+    {
+        return size_same(it, eit, typename std::iterator_traits<It>::iterator_category());
+    }
+
+    static size_t size_same(It it, It const eit, std::input_iterator_tag)
+    {
+        size_t res = 0;
+        for (; it != eit; ++it)
+            ++res;
+        return res;
+    }
+
+    static size_t size_same(It const it, It const eit, std::random_access_iterator_tag)
+    {
+        return static_cast<size_t>(eit - it);
+    }
+};
+
+enum struct converted_sizez_impl { normal, contiguous, same };
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    converted_sizez_impl>
+struct converted_sizez_strategy final
+{
+    size_t operator()(It it) const
+    {
+        auto const read_fn = [&it] { return *it++; };
+        size_t res = 0;
+        while (true)
+        {
+            auto const cp = Utf::read(read_fn);
+            if (!cp)
+                return res;
+            res += units<Outf>(cp);
+        }
+    }
+};
+
+// The overlong forms of zero terminate the string as well, so the bulk counting stops before any lead followed by 0x80
+template<typename Ch>
+Ch const * find_terminator(Ch const * it, utf8) throw()
+{
+    for (; *it; ++it)
+        if (static_cast<uint8_t>(it[1]) == 0x80)
+            switch (static_cast<uint8_t>(*it))
+            {
+            case 0xC0: case 0xE0: case 0xF0: case 0xF8: case 0xFC:
+                return it;
+            }
+    return it;
+}
+
+template<typename Ch>
+Ch const * find_terminator(Ch const * const it, utf8_dfa) throw()
+{
+    return find_terminator(it, utf8());
+}
+
+template<
+    typename Ch,
+    typename Utf>
+Ch const * find_terminator(Ch const * it, Utf) throw()
+{
+    for (; *it; ++it)
+        ;
+    return it;
+}
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+struct converted_sizez_strategy<Utf, Outf, It, converted_sizez_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    size_t operator()(char_type const * it) const
+    {
+        auto const res = converted_size_strategy<Utf, Outf, It, converted_size_impl::contiguous>::apply(
+            it, find_terminator(it, Utf()), [&it] { return *it++; });
+        return res + converted_sizez_strategy<Utf, Outf, char_type const *, converted_sizez_impl::normal>()(it);
+    }
+};
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+struct converted_sizez_strategy<Utf, Outf, It, converted_sizez_impl::same> final
+{
+    size_t operator()(It it) const
+    {
+        size_t res = 0;
+        for (; *it; ++it)
+            ++res;
+        return res;
+    }
+};
+
+}
+
+template<
+    typename Utf,
+    typename Policy = error_throw,
+    typename It,
+    typename std::enable_if<std::is_same<Policy, error_throw>::value, void *>::type = nullptr>
+size_t size(It && it)
+{
+    using it_type = typename std::decay<It>::type;
+    return detail::sizez_strategy<Utf, it_type, detail::size_selector<Utf, it_type>::value>()(std::forward<It>(it));
+}
+
+template<
+    typename Utf,
+    typename Policy = error_throw,
+    typename It,
+    typename Eit,
+    typename std::enable_if<std::is_same<Policy, error_throw>::value, void *>::type = nullptr>
+size_t size(It && it, Eit && eit)
+{
+    using it_type = typename std::decay<It>::type;
+    return detail::size_strategy<Utf, it_type, detail::size_selector<Utf, it_type>::value>()(
+        std::forward<It>(it),
+        std::forward<Eit>(eit));
 }
 
 template<typename Ch>
@@ -122,16 +1072,158 @@ size_t size(Ch const * str)
 }
 
 template<typename Ch>
-size_t size(std::basic_string<Ch> str)
+size_t size(std::basic_string<Ch> const & str)
 {
-    return size<utf_selector_t<Ch>>(str.cbegin(), str.cend());
+    return size<utf_selector_t<Ch>>(str.data(), str.data() + str.size());
 }
 
 #if __cpp_lib_string_view >= 201606
 template<typename Ch>
-size_t size(std::basic_string_view<Ch> str)
+size_t size(std::basic_string_view<Ch> const & str)
+{
+    return size<utf_selector_t<Ch>>(str.data(), str.data() + str.size());
+}
+#endif
+
+// Returns the end of the longest prefix of the valid input which takes at most `max_units` units. Only the symbol cut by
+// the limit is visited, so the input after the prefix is not validated.
+template<
+    typename Utf,
+    typename It>
+It truncate(It const first, It const last, size_t const max_units)
+{
+    if (static_cast<size_t>(last - first) <= max_units)
+        return last;
+    auto const cut = first + max_units;
+    return prev_boundary<Utf>(first, cut + 1);
+}
+
+namespace detail {
+
+template<
+    typename Utf,
+    typename It,
+    size_impl>
+struct truncate_codepoints_strategy final
+{
+    It operator()(It it, It const last, size_t const max_cp) const
+    {
+        size_t total_cp = 0;
+        for (; it != last; ++it)
+            if (cp_lead<Utf>::test(*it) && total_cp++ == max_cp)
+                break;
+        return it;
+    }
+};
+
+// The input of `max_cp - total_cp` units has at most that many code points, so the leads are counted in bulk and the
+// distance shrinks with every round. The last units before the limit are scanned one by one.
+template<
+    typename Utf,
+    typename It>
+struct truncate_codepoints_strategy<Utf, It, size_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    static size_t const min_bulk_size = 32;
+
+    It operator()(It it, It const last, size_t const max_cp) const
+    {
+        auto const kernel = block_size<Utf, utf32>::template kernel<char_type, utf32>();
+        size_t total_cp = 0;
+        while (it != last)
+        {
+            auto const distance = max_cp - total_cp;
+            if (distance >= min_bulk_size)
+            {
+                char_type const * piece_it = it;
+                total_cp += kernel(piece_it, it + std::min<size_t>(distance, static_cast<size_t>(last - it)));
+                if (piece_it != it)
+                {
+                    it += piece_it - it;
+                    continue;
+                }
+            }
+            if (cp_lead<Utf>::test(*it) && total_cp++ == max_cp)
+                break;
+            ++it;
+        }
+        return it;
+    }
+};
+
+}
+
+// Returns the end of the prefix of the valid input which has at most `max_cp` code points. The input is not validated.
+template<
+    typename Utf,
+    typename It>
+It truncate_codepoints(It const first, It const last, size_t const max_cp)
+{
+    return detail::truncate_codepoints_strategy<Utf, It, detail::size_selector<Utf, It>::value>()(first, last, max_cp);
+}
+
+// Returns the number of `Outf` code units `conv` writes for the input and throws the same errors as `conv`
+template<
+    typename Utf,
+    typename Outf,
+    typename It,
+    typename Eit>
+size_t converted_size(It && it, Eit && eit)
+{
+    return detail::converted_size_strategy<Utf, Outf,
+            typename std::decay<It>::type,
+            std::is_same<Utf, Outf>::value
+                ? detail::converted_size_impl::same
+                : detail::block_size<Utf, Outf>::enabled && detail::is_contiguous_input<Utf, typename std::decay<It>::type>::value
+                    ? detail::converted_size_impl::contiguous
+                    : detail::converted_size_impl::normal>()(
+        std::forward<It>(it),
+        std::forward<Eit>(eit));
+}
+
+// Returns the number of `Outf` code units `convz` writes for the null-terminated input
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+size_t converted_sizez(It && it)
+{
+    return detail::converted_sizez_strategy<Utf, Outf,
+            typename std::decay<It>::type,
+            std::is_same<Utf, Outf>::value
+                ? detail::converted_sizez_impl::same
+                : detail::block_size<Utf, Outf>::enabled && detail::is_contiguous_input<Utf, typename std::decay<It>::type>::value
+                    ? detail::converted_sizez_impl::contiguous
+                    : detail::converted_sizez_impl::normal>()(
+        std::forward<It>(it));
+}
+
+template<
+    typename Outf,
+    typename Ch>
+size_t converted_sizez(Ch const * const str)
+{
+    return converted_sizez<utf_selector_t<Ch>, Outf>(str);
+}
+
+template<
+    typename Outf,
+    typename Ch,
+    typename Traits,
+    typename Alloc>
+size_t converted_size(std::basic_string<Ch, Traits, Alloc> const & str)
+{
+    return converted_size<utf_selector_t<Ch>, Outf>(str.data(), str.data() + str.size());
+}
+
+#if __cpp_lib_string_view >= 201606
+template<
+    typename Outf,
+    typename Ch>
+size_t converted_size(std::basic_string_view<Ch> const & str)
 {
-    return size<utf_selector_t<Ch>>(str.cbegin(), str.cend());
+    return converted_size<utf_selector_t<Ch>, Outf>(str.data(), str.data() + str.size());
 }
 #endif
 
@@ -0,0 +1,240 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_converters.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include <string>
+
+#if __cpp_lib_string_view >= 201606
+#include <string_view>
+#endif
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+// Returns the beginning of the symbol which is cut by the end of the chunk, or `eit` when the last symbol is complete.
+// The malformed tail is returned as complete, so the error is reported by `conv` as soon as possible. The tail is cut
+// only if the units before it end on the symbol boundary, otherwise the previous symbol is broken by the tail lead and
+// `conv` reports it. `it` is the symbol boundary.
+template<typename Utf>
+struct tail_finder final {};
+
+template<>
+struct tail_finder<utf8> final
+{
+    template<typename It>
+    static It find(It const it, It const eit)
+    {
+        for (size_t n = 1; n < utf8::max_supported_symbol_size && static_cast<size_t>(eit - it) >= n; ++n)
+        {
+            uint8_t const ch = *(eit - n);
+            if (ch >> 6 == 2)
+                continue;
+            return lead_size(ch) > n && boundary(it, eit - n) ? eit - n : eit;
+        }
+        return eit;
+    }
+
+private:
+    static size_t lead_size(uint8_t const ch) throw()
+    {
+        return
+            ch < 0xC0 ? 1 :
+            ch < 0xE0 ? 2 :
+            ch < 0xF0 ? 3 :
+            ch < 0xF8 ? 4 :
+            ch < 0xFC ? 5 :
+            ch < 0xFE ? 6 : 1;
+    }
+
+    // Only the symbol whose lead expects more slave chars ends before `eit` incomplete, the other malformed input
+    // before `eit` is reported by `conv` anyway
+    template<typename It>
+    static bool boundary(It const it, It const eit)
+    {
+        for (size_t n = 1; n < utf8::max_supported_symbol_size && static_cast<size_t>(eit - it) >= n; ++n)
+        {
+            uint8_t const ch = *(eit - n);
+            if (ch >> 6 != 2)
+                return lead_size(ch) <= n;
+        }
+        return true;
+    }
+};
+
+template<>
+struct tail_finder<utf8_dfa> final
+{
+    template<typename It>
+    static It find(It const it, It const eit)
+    {
+        return tail_finder<utf8>::find(it, eit);
+    }
+};
+
+template<>
+struct tail_finder<utf16> final
+{
+    template<typename It>
+    static It find(It const it, It const eit)
+    {
+        // The high surrogate followed by the other one is the error of the former
+        return
+            it != eit && static_cast<uint16_t>(*(eit - 1)) >> 10 == 0x36 &&
+            (eit - 1 == it || static_cast<uint16_t>(*(eit - 2)) >> 10 != 0x36)
+                ? eit - 1
+                : eit;
+    }
+};
+
+template<>
+struct tail_finder<utf32> final
+{
+    template<typename It>
+    static It find(It, It const eit)
+    {
+        return eit;
+    }
+};
+
+template<>
+struct tail_finder<latin1> final
+{
+    template<typename It>
+    static It find(It, It const eit)
+    {
+        return eit;
+    }
+};
+
+template<>
+struct tail_finder<ascii> final
+{
+    template<typename It>
+    static It find(It, It const eit)
+    {
+        return eit;
+    }
+};
+
+}
+
+// Converts the input which arrives by chunks. The symbol cut by the end of the chunk is kept until the next `feed`, the
+// bulk of every chunk is converted by `conv`. The malformed input throws the same errors as `conv` does, the symbol
+// which is still incomplete at the end of the input is reported by `finish`.
+template<
+    typename Utf,
+    typename Outf>
+class basic_transcoder final
+{
+public:
+    // The input should be random access, normally it is the pointers to the chunk
+    template<
+        typename It,
+        typename Oit>
+    Oit feed(It it, It const eit, Oit oit)
+    {
+        if (pending_size_)
+        {
+            auto const size = Utf::char_size([this] { return pending_[0]; });
+            for (; pending_size_ < size && it != eit; ++it)
+                pending_[pending_size_++] = static_cast<char_type>(*it);
+            if (pending_size_ < size && !malformed_pending())
+                return oit;
+            auto const pending_size = pending_size_;
+            pending_size_ = 0;
+            oit = conv<Utf, Outf>(pending_, pending_ + pending_size, std::move(oit));
+        }
+        auto const tail = detail::tail_finder<Utf>::find(it, eit);
+        oit = conv<Utf, Outf>(it, tail, std::move(oit));
+        for (auto cur = tail; cur != eit; ++cur)
+            pending_[pending_size_++] = static_cast<char_type>(*cur);
+        return oit;
+    }
+
+    template<
+        typename Ch,
+        typename Oit>
+    typename std::decay<Oit>::type feed(std::basic_string<Ch> const & chunk, Oit && oit)
+    {
+        return feed(chunk.data(), chunk.data() + chunk.size(), std::forward<Oit>(oit));
+    }
+
+#if __cpp_lib_string_view >= 201606
+    template<
+        typename Ch,
+        typename Oit>
+    typename std::decay<Oit>::type feed(std::basic_string_view<Ch> const & chunk, Oit && oit)
+    {
+        return feed(chunk.data(), chunk.data() + chunk.size(), std::forward<Oit>(oit));
+    }
+#endif
+
+    // Throws when the input ended in the middle of the symbol. The transcoder is ready for the next input anyway.
+    void finish()
+    {
+        if (!pending_size_)
+            return;
+        pending_size_ = 0;
+        throw std::runtime_error("Not enough input");
+    }
+
+    // The number of units of the incomplete symbol kept from the previous chunks
+    size_t pending() const throw()
+    {
+        return pending_size_;
+    }
+
+    void reset() throw()
+    {
+        pending_size_ = 0;
+    }
+
+private:
+    using char_type = typename Utf::char_type;
+
+    // The incomplete symbol with the incorrect slave char is reported at once, as `conv` does
+    bool malformed_pending() const
+    {
+        char_type const * it = pending_;
+        uint32_t cp;
+        return Utf::decode(it, pending_ + pending_size_, cp) != utf_error::not_enough_input;
+    }
+
+    char_type pending_[Utf::max_supported_symbol_size];
+    size_t pending_size_ = 0;
+};
+
+}}
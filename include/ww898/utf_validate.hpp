@@ -0,0 +1,723 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_dispatch.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <string>
+
+#if __cpp_lib_string_view >= 201606
+#include <string_view>
+#endif
+
+#if defined(WW898_UTF_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(WW898_UTF_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace ww898 {
+namespace utf {
+namespace detail {
+
+// The end of the null-terminated input
+struct null_terminator final {};
+
+template<typename It>
+bool operator==(It const & it, null_terminator) { return !*it; }
+
+template<typename It>
+bool operator!=(It const & it, null_terminator) { return !!*it; }
+
+template<typename Ch>
+using skip_kernel = Ch const * (*)(Ch const *, Ch const *);
+
+// Steps back to the lead char of the last symbol before the block, the symbol can be incomplete
+template<typename Ch>
+Ch const * utf8_symbol_begin(Ch const * const first, Ch const * const it) throw()
+{
+    auto cur = it;
+    for (size_t n = 0; cur != first && n < utf8::max_supported_symbol_size; ++n)
+        if (static_cast<uint8_t>(*--cur) >> 6 != 2)
+            return static_cast<uint8_t>(*cur) < 0x80 ? cur + 1 : cur;
+    return cur;
+}
+
+// The slave char is expected exactly at the positions covered by the preceding lead chars:
+//   1 position  after [0xC0‥0xFD]
+//   2 positions after [0xE0‥0xFD]
+//   3 positions after [0xF0‥0xFD]
+//   4 positions after [0xF8‥0xFD]
+//   5 positions after [0xFC‥0xFD]
+// Chars 0xFE and 0xFF are never allowed.
+template<isa level>
+struct utf8_skip : utf8_skip<kernel_fallback<level>::value> {};
+
+template<>
+struct utf8_skip<isa::scalar>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const *) throw()
+    {
+        return first;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf8_skip<isa::sse2>
+{
+    template<int shift>
+    static __m128i prev(__m128i const cur, __m128i const prv) throw()
+    {
+        return _mm_or_si128(_mm_slli_si128(cur, shift), _mm_srli_si128(prv, 16 - shift));
+    }
+
+    static __m128i ge(__m128i const v, uint8_t const min) throw()
+    {
+        return _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(static_cast<char>(min))), v);
+    }
+
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto prv = _mm_setzero_si128();
+        for (; eit - it >= 16; it += 16)
+        {
+            auto const cur = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+            if (!_mm_movemask_epi8(_mm_or_si128(cur, prv)))
+                continue;
+            auto const expected =
+                _mm_or_si128(ge(prev<1>(cur, prv), 0xC0),
+                _mm_or_si128(ge(prev<2>(cur, prv), 0xE0),
+                _mm_or_si128(ge(prev<3>(cur, prv), 0xF0),
+                _mm_or_si128(ge(prev<4>(cur, prv), 0xF8),
+                             ge(prev<5>(cur, prv), 0xFC)))));
+            auto const slave = _mm_cmplt_epi8(cur, _mm_set1_epi8(-64));
+            auto const error = _mm_or_si128(_mm_xor_si128(expected, slave), ge(cur, 0xFE));
+            if (_mm_movemask_epi8(error))
+                break;
+            prv = cur;
+        }
+        return utf8_symbol_begin(first, it);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf8_skip<isa::avx2>
+{
+    template<int shift>
+    WW898_UTF_TARGET_AVX2 static __m256i prev(__m256i const cur, __m256i const prv) throw()
+    {
+        return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prv, cur, 0x21), 16 - shift);
+    }
+
+    WW898_UTF_TARGET_AVX2 static __m256i ge(__m256i const v, uint8_t const min) throw()
+    {
+        return _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(static_cast<char>(min))), v);
+    }
+
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX2 static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto prv = _mm256_setzero_si256();
+        for (; eit - it >= 32; it += 32)
+        {
+            auto const cur = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+            if (!_mm256_movemask_epi8(_mm256_or_si256(cur, prv)))
+                continue;
+            auto const expected =
+                _mm256_or_si256(ge(prev<1>(cur, prv), 0xC0),
+                _mm256_or_si256(ge(prev<2>(cur, prv), 0xE0),
+                _mm256_or_si256(ge(prev<3>(cur, prv), 0xF0),
+                _mm256_or_si256(ge(prev<4>(cur, prv), 0xF8),
+                                ge(prev<5>(cur, prv), 0xFC)))));
+            auto const slave = _mm256_cmpgt_epi8(_mm256_set1_epi8(-64), cur);
+            auto const error = _mm256_or_si256(_mm256_xor_si256(expected, slave), ge(cur, 0xFE));
+            if (_mm256_movemask_epi8(error))
+                return utf8_symbol_begin(first, it);
+            prv = cur;
+        }
+        return utf8_skip<isa::sse2>::run(utf8_symbol_begin(first, it), eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX512)
+template<>
+struct utf8_skip<isa::avx512>
+{
+    template<int shift>
+    WW898_UTF_TARGET_AVX512 static __m512i prev(__m512i const cur, __m512i const prv) throw()
+    {
+        // The previous 128-bit lane for every lane of `cur`
+        auto const lanes = _mm512_permutex2var_epi64(prv, _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6), cur);
+        return _mm512_alignr_epi8(cur, lanes, 16 - shift);
+    }
+
+    WW898_UTF_TARGET_AVX512 static __mmask64 ge(__m512i const v, uint8_t const min) throw()
+    {
+        return _mm512_cmpge_epu8_mask(v, _mm512_set1_epi8(static_cast<char>(min)));
+    }
+
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX512 static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto prv = _mm512_setzero_si512();
+        for (; eit - it >= 64; it += 64)
+        {
+            auto const cur = _mm512_loadu_si512(it);
+            if (!_mm512_movepi8_mask(_mm512_or_si512(cur, prv)))
+                continue;
+            auto const expected =
+                ge(prev<1>(cur, prv), 0xC0) |
+                ge(prev<2>(cur, prv), 0xE0) |
+                ge(prev<3>(cur, prv), 0xF0) |
+                ge(prev<4>(cur, prv), 0xF8) |
+                ge(prev<5>(cur, prv), 0xFC);
+            auto const slave = _mm512_cmplt_epi8_mask(cur, _mm512_set1_epi8(-64));
+            if ((expected ^ slave) | ge(cur, 0xFE))
+                return utf8_symbol_begin(first, it);
+            prv = cur;
+        }
+        return utf8_skip<isa::avx2>::run(utf8_symbol_begin(first, it), eit);
+    }
+};
+#endif
+
+// Steps back to the high surrogate of the pair crossing the block boundary
+template<typename Ch>
+Ch const * utf16_symbol_begin(Ch const * const first, Ch const * const it) throw()
+{
+    return it != first && static_cast<uint16_t>(it[-1]) >> 10 == 0x36 ? it - 1 : it;
+}
+
+// The low surrogate is expected exactly after the high one
+template<isa level>
+struct utf16_skip : utf16_skip<kernel_fallback<level>::value> {};
+
+template<>
+struct utf16_skip<isa::scalar>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const *) throw()
+    {
+        return first;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf16_skip<isa::sse2>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto const mask = _mm_set1_epi16(static_cast<short>(0xFC00));
+        auto const high_tag = _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_high));
+        auto const low_tag = _mm_set1_epi16(static_cast<short>(utf16::min_surrogate_low));
+        auto prev_high = _mm_setzero_si128();
+        for (; eit - it >= 8; it += 8)
+        {
+            auto const cur = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it)), mask);
+            auto const high = _mm_cmpeq_epi16(cur, high_tag);
+            auto const low = _mm_cmpeq_epi16(cur, low_tag);
+            auto const expected = _mm_or_si128(_mm_slli_si128(high, 2), _mm_srli_si128(prev_high, 14));
+            if (_mm_movemask_epi8(_mm_xor_si128(expected, low)))
+                break;
+            prev_high = high;
+        }
+        return utf16_symbol_begin(first, it);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf16_skip<isa::avx2>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX2 static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto const mask = _mm256_set1_epi16(static_cast<short>(0xFC00));
+        auto const high_tag = _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate_high));
+        auto const low_tag = _mm256_set1_epi16(static_cast<short>(utf16::min_surrogate_low));
+        auto prev_high = _mm256_setzero_si256();
+        for (; eit - it >= 16; it += 16)
+        {
+            auto const cur = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it)), mask);
+            auto const high = _mm256_cmpeq_epi16(cur, high_tag);
+            auto const low = _mm256_cmpeq_epi16(cur, low_tag);
+            auto const expected = _mm256_alignr_epi8(high, _mm256_permute2x128_si256(prev_high, high, 0x21), 14);
+            if (_mm256_movemask_epi8(_mm256_xor_si256(expected, low)))
+                return utf16_symbol_begin(first, it);
+            prev_high = high;
+        }
+        return utf16_skip<isa::sse2>::run(utf16_symbol_begin(first, it), eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX512)
+template<>
+struct utf16_skip<isa::avx512>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX512 static Ch const * run(Ch const * const first, Ch const * const eit) throw()
+    {
+        auto it = first;
+        auto const mask = _mm512_set1_epi16(static_cast<short>(0xFC00));
+        auto const high_tag = _mm512_set1_epi16(static_cast<short>(utf16::min_surrogate_high));
+        auto const low_tag = _mm512_set1_epi16(static_cast<short>(utf16::min_surrogate_low));
+        __mmask32 prev_high = 0;
+        for (; eit - it >= 32; it += 32)
+        {
+            auto const cur = _mm512_and_si512(_mm512_loadu_si512(it), mask);
+            auto const high = _mm512_cmpeq_epi16_mask(cur, high_tag);
+            auto const low = _mm512_cmpeq_epi16_mask(cur, low_tag);
+            if ((static_cast<uint32_t>(high) << 1 | static_cast<uint32_t>(prev_high) >> 31) != low)
+                return utf16_symbol_begin(first, it);
+            prev_high = high;
+        }
+        return utf16_skip<isa::avx2>::run(utf16_symbol_begin(first, it), eit);
+    }
+};
+#endif
+
+// Only 31-bit values are allowed
+template<isa level>
+struct utf32_skip : utf32_skip<kernel_fallback<level>::value> {};
+
+template<>
+struct utf32_skip<isa::scalar>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const *) throw()
+    {
+        return first;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct utf32_skip<isa::sse2>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * it, Ch const * const eit) throw()
+    {
+        for (; eit - it >= 4; it += 4)
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it))) & 0x8888)
+                break;
+        return it;
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct utf32_skip<isa::avx2>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX2 static Ch const * run(Ch const * it, Ch const * const eit) throw()
+    {
+        for (; eit - it >= 8; it += 8)
+            if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it)))))
+                return it;
+        return utf32_skip<isa::sse2>::run(it, eit);
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX512)
+template<>
+struct utf32_skip<isa::avx512>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX512 static Ch const * run(Ch const * it, Ch const * const eit) throw()
+    {
+        for (; eit - it >= 16; it += 16)
+            if (_mm512_cmplt_epi32_mask(_mm512_loadu_si512(it), _mm512_setzero_si512()))
+                return it;
+        return utf32_skip<isa::avx2>::run(it, eit);
+    }
+};
+#endif
+
+template<isa level>
+struct ascii_skip : ascii_skip<kernel_fallback<level>::value> {};
+
+template<>
+struct ascii_skip<isa::scalar>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * const first, Ch const *) throw()
+    {
+        return first;
+    }
+};
+
+#if defined(WW898_UTF_SSE2)
+template<>
+struct ascii_skip<isa::sse2>
+{
+    template<typename Ch>
+    static Ch const * run(Ch const * it, Ch const * const eit) throw()
+    {
+        for (; eit - it >= 16; it += 16)
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(it))))
+                break;
+        return it;
+    }
+};
+#endif
+
+#if defined(WW898_UTF_AVX2)
+template<>
+struct ascii_skip<isa::avx2>
+{
+    template<typename Ch>
+    WW898_UTF_TARGET_AVX2 static Ch const * run(Ch const * it, Ch const * const eit) throw()
+    {
+        for (; eit - it >= 32; it += 32)
+            if (_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(it))))
+                return it;
+        return ascii_skip<isa::sse2>::run(it, eit);
+    }
+};
+#endif
+
+// Every validator accepts exactly the same input as the `read` function of the corresponding codec. The `scalar`
+// functions return the beginning of the first malformed or incomplete symbol. The `skip` functions validate the
+// contiguous input block by block and return the beginning of the symbol where the scalar validation should be
+// continued, so the exact position of the error is always found by the scalar code.
+template<typename Utf>
+struct validator final {};
+
+template<>
+struct validator<utf8> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        while (it != eit)
+        {
+            uint8_t const ch0 = *it;
+            if (ch0 < 0x80)
+            {
+                ++it;
+                continue;
+            }
+            size_t const size =
+                ch0 < 0xC0 ? 0 :
+                ch0 < 0xE0 ? 2 :
+                ch0 < 0xF0 ? 3 :
+                ch0 < 0xF8 ? 4 :
+                ch0 < 0xFC ? 5 :
+                ch0 < 0xFE ? 6 : 0;
+            if (!size)
+                return it;
+            auto next = it;
+            for (size_t n = 1; n < size; ++n)
+                if (++next == eit || static_cast<uint8_t>(*next) >> 6 != 2)
+                    return it;
+            it = ++next;
+        }
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const * const eit) throw()
+    {
+        return dispatch<skip_kernel<Ch>, utf8_skip, Ch>()(first, eit);
+    }
+};
+
+// The bulk skip is shared with `utf8`, the scalar validation runs the automaton
+template<>
+struct validator<utf8_dfa> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        using tables = utf8_dfa_tables<>;
+        auto symbol = it;
+        uint32_t state = tables::accept;
+        while (it != eit)
+        {
+            uint8_t const ch = *it;
+            state = tables::next(tables::row(ch), state);
+            if (state == tables::reject)
+                break;
+            ++it;
+            if (state == tables::accept)
+                symbol = it;
+        }
+        return symbol;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const * const eit) throw()
+    {
+        return validator<utf8>::skip(first, eit);
+    }
+};
+
+template<>
+struct validator<utf16> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        while (it != eit)
+        {
+            uint16_t const ch0 = *it;
+            if (ch0 < utf16::min_surrogate || ch0 > utf16::max_surrogate)
+            {
+                ++it;
+                continue;
+            }
+            if (ch0 > utf16::max_surrogate_high)
+                return it;
+            auto next = it;
+            if (++next == eit || static_cast<uint16_t>(*next) >> 10 != 0x37)
+                return it;
+            it = ++next;
+        }
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const * const eit) throw()
+    {
+        return dispatch<skip_kernel<Ch>, utf16_skip, Ch>()(first, eit);
+    }
+};
+
+template<>
+struct validator<utf32> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        for (; it != eit; ++it)
+            if (static_cast<uint32_t>(*it) >= 0x80000000)
+                return it;
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const * const eit) throw()
+    {
+        return dispatch<skip_kernel<Ch>, utf32_skip, Ch>()(first, eit);
+    }
+};
+
+template<>
+struct validator<latin1> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        while (it != eit)
+            ++it;
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const *, Ch const * const eit) throw()
+    {
+        return eit;
+    }
+};
+
+template<>
+struct validator<ascii> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        for (; it != eit; ++it)
+            if (static_cast<uint8_t>(*it) >= 0x80)
+                return it;
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const * const eit) throw()
+    {
+        return dispatch<skip_kernel<Ch>, ascii_skip, Ch>()(first, eit);
+    }
+};
+
+// The foreign byte order is validated by the native codec symbol by symbol
+template<typename Utf>
+struct validator<utf_swapped<Utf>> final
+{
+    template<
+        typename It,
+        typename Eit>
+    static It scalar(It it, Eit const eit)
+    {
+        while (it != eit)
+        {
+            auto next = it;
+            uint32_t cp;
+            if (utf_swapped<Utf>::decode(next, eit, cp) != utf_error::none)
+                return it;
+            it = next;
+        }
+        return it;
+    }
+
+    template<typename Ch>
+    static Ch const * skip(Ch const * const first, Ch const *) throw()
+    {
+        return first;
+    }
+};
+
+enum struct validate_impl { normal, contiguous };
+
+template<
+    typename Utf,
+    typename It,
+    validate_impl>
+struct validate_strategy final
+{
+    template<typename Eit>
+    It operator()(It it, Eit const eit) const
+    {
+        return validator<Utf>::scalar(it, eit);
+    }
+};
+
+template<
+    typename Utf,
+    typename It>
+struct validate_strategy<Utf, It, validate_impl::contiguous> final
+{
+    using char_type = typename std::remove_cv<typename std::remove_pointer<It>::type>::type;
+
+    It operator()(It it, char_type const * const eit) const
+    {
+        char_type const * const first = it;
+        return it + (validator<Utf>::scalar(validator<Utf>::skip(first, eit), eit) - first);
+    }
+};
+
+}
+
+// Returns the beginning of the first malformed or incomplete symbol, or `eit` when the whole input is valid
+template<
+    typename Utf,
+    typename It,
+    typename Eit>
+typename std::decay<It>::type validate(It && it, Eit && eit)
+{
+    using it_type = typename std::decay<It>::type;
+    return detail::validate_strategy<Utf, it_type,
+            std::is_pointer<it_type>::value &&
+            std::is_integral<typename std::remove_pointer<it_type>::type>::value &&
+            sizeof(typename std::remove_pointer<it_type>::type) == sizeof(typename Utf::char_type)
+                ? detail::validate_impl::contiguous
+                : detail::validate_impl::normal>()(
+        std::forward<It>(it),
+        std::forward<Eit>(eit));
+}
+
+// Returns the beginning of the first malformed or incomplete symbol, or the terminating zero
+template<
+    typename Utf,
+    typename It>
+It validate(It it)
+{
+    return detail::validator<Utf>::scalar(it, detail::null_terminator());
+}
+
+template<
+    typename Utf,
+    typename It,
+    typename Eit>
+bool is_valid(It it, Eit const eit)
+{
+    return validate<Utf>(it, eit) == eit;
+}
+
+template<
+    typename Utf,
+    typename It>
+bool is_valid(It it)
+{
+    return !*validate<Utf>(it);
+}
+
+template<typename Ch>
+bool is_valid(Ch const * str)
+{
+    return is_valid<utf_selector_t<Ch>>(str);
+}
+
+template<typename Ch>
+bool is_valid(std::basic_string<Ch> const & str)
+{
+    return is_valid<utf_selector_t<Ch>>(str.data(), str.data() + str.size());
+}
+
+#if __cpp_lib_string_view >= 201606
+template<typename Ch>
+bool is_valid(std::basic_string_view<Ch> str)
+{
+    return is_valid<utf_selector_t<Ch>>(str.data(), str.data() + str.size());
+}
+#endif
+
+}}
@@ -0,0 +1,212 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <ww898/utf_selector.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if __cpp_lib_string_view >= 201606
+#include <string_view>
+#endif
+
+#if __cpp_lib_ranges >= 201911
+#include <ranges>
+#endif
+
+namespace ww898 {
+namespace utf {
+
+// Decodes the code points of the contiguous input on the fly. The symbol is decoded once on the first dereference or
+// increment, the malformed symbol throws the same errors as `conv`. The decrement steps back over the slave units to
+// the lead of the previous symbol.
+template<
+    typename Utf,
+    typename Ch = typename Utf::char_type>
+class codepoint_iterator final
+{
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+#if __cpp_lib_ranges >= 201911
+    using iterator_concept = std::bidirectional_iterator_tag;
+#endif
+    using value_type = uint32_t;
+    using difference_type = ptrdiff_t;
+    using pointer = uint32_t const *;
+    using reference = uint32_t;
+
+    codepoint_iterator() throw()
+        : first_(nullptr)
+        , it_(nullptr)
+        , eit_(nullptr)
+        , next_(nullptr)
+        , cp_(0)
+    {
+    }
+
+    codepoint_iterator(Ch const * const first, Ch const * const it, Ch const * const eit) throw()
+        : first_(first)
+        , it_(it)
+        , eit_(eit)
+        , next_(it)
+        , cp_(0)
+    {
+    }
+
+    // The position of the current symbol in the input
+    Ch const * base() const throw() { return it_; }
+
+    uint32_t operator*() const
+    {
+        decode();
+        return cp_;
+    }
+
+    codepoint_iterator & operator++()
+    {
+        decode();
+        it_ = next_;
+        return *this;
+    }
+
+    codepoint_iterator operator++(int)
+    {
+        auto const res = *this;
+        ++*this;
+        return res;
+    }
+
+    codepoint_iterator & operator--()
+    {
+        it_ = next_ = prev_boundary<Utf>(first_, it_);
+        return *this;
+    }
+
+    codepoint_iterator operator--(int)
+    {
+        auto const res = *this;
+        --*this;
+        return res;
+    }
+
+    friend bool operator==(codepoint_iterator const & x, codepoint_iterator const & y) throw() { return x.it_ == y.it_; }
+    friend bool operator!=(codepoint_iterator const & x, codepoint_iterator const & y) throw() { return x.it_ != y.it_; }
+
+private:
+    void decode() const
+    {
+        if (next_ != it_)
+            return;
+        auto it = it_;
+        auto const eit = eit_;
+        cp_ = Utf::read([&it, eit]
+            {
+                if (it == eit)
+                    throw std::runtime_error("Not enough input");
+                return *it++;
+            });
+        next_ = it;
+    }
+
+    Ch const * first_;
+    Ch const * it_;
+    Ch const * eit_;
+    mutable Ch const * next_;
+    mutable uint32_t cp_;
+};
+
+// The non-owning view of the code points of the contiguous input, the input should outlive the view and the iterators
+template<
+    typename Utf,
+    typename Ch = typename Utf::char_type>
+class codepoint_view final
+#if __cpp_lib_ranges >= 201911
+    : public std::ranges::view_interface<codepoint_view<Utf, Ch>>
+#endif
+{
+public:
+    using iterator = codepoint_iterator<Utf, Ch>;
+    using const_iterator = iterator;
+
+    codepoint_view() throw()
+        : it_(nullptr)
+        , eit_(nullptr)
+    {
+    }
+
+    codepoint_view(Ch const * const it, Ch const * const eit) throw()
+        : it_(it)
+        , eit_(eit)
+    {
+    }
+
+    iterator begin() const throw() { return iterator(it_, it_, eit_); }
+    iterator end() const throw() { return iterator(it_, eit_, eit_); }
+
+    bool empty() const throw() { return it_ == eit_; }
+
+private:
+    Ch const * it_;
+    Ch const * eit_;
+};
+
+template<typename Ch>
+codepoint_view<utf_selector_t<Ch>, Ch> make_codepoint_view(Ch const * const it, Ch const * const eit) throw()
+{
+    return codepoint_view<utf_selector_t<Ch>, Ch>(it, eit);
+}
+
+template<typename Ch>
+codepoint_view<utf_selector_t<Ch>, Ch> make_codepoint_view(std::basic_string<Ch> const & str) throw()
+{
+    return codepoint_view<utf_selector_t<Ch>, Ch>(str.data(), str.data() + str.size());
+}
+
+#if __cpp_lib_string_view >= 201606
+template<typename Ch>
+codepoint_view<utf_selector_t<Ch>, Ch> make_codepoint_view(std::basic_string_view<Ch> const str) throw()
+{
+    return codepoint_view<utf_selector_t<Ch>, Ch>(str.data(), str.data() + str.size());
+}
+#endif
+
+}}
+
+#if __cpp_lib_ranges >= 201911
+namespace std {
+namespace ranges {
+
+template<
+    typename Utf,
+    typename Ch>
+inline constexpr bool enable_borrowed_range<ww898::utf::codepoint_view<Utf, Ch>> = true;
+
+}}
+#endif
@@ -29,7 +29,17 @@
 #endif
 
 #include <ww898/utf_converters.hpp>
+#include <ww898/utf_dispatch.hpp>
 #include <ww898/utf_sizes.hpp>
+#include <ww898/utf_transcoder.hpp>
+#include <ww898/utf_parallel.hpp>
+#include <ww898/utf_batch.hpp>
+#include <ww898/utf_index.hpp>
+#include <ww898/utf_offsets.hpp>
+#include <ww898/utf_view.hpp>
+#include <ww898/utf_detect.hpp>
+#include <ww898/utf_literal.hpp>
+#include <ww898/utf_validate.hpp>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -49,6 +59,16 @@
 #include <iostream>
 #include <iomanip>
 #include <codecvt>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#endif
 
 #if defined(__linux__) || defined(__APPLE__)
 #include <chrono>
@@ -400,6 +420,47 @@ supported_tuple const supported_test_data[] =
     },
 };
 
+template<typename Ch>
+struct malformed_tuple final
+{
+    std::basic_string<Ch> buf;
+    size_t offset;
+};
+
+malformed_tuple<char> const malformed_u8_test_data[] =
+{
+    { { '\x80' }, 0 },
+    { { '\x41', '\xBF' }, 1 },
+    { { '\xC2' }, 0 },
+    { { '\xC2', '\x41' }, 0 },
+    { { '\xE2', '\x82' }, 0 },
+    { { '\xE2', '\x82', '\xAC', '\xE2', '\x28', '\xAC' }, 3 },
+    { { '\xF0', '\x90', '\x8D' }, 0 },
+    { { '\xF0', '\x90', '\x8D', '\x88', '\x88' }, 4 },
+    { { '\xFA', '\x95', '\xA9', '\xB6', '\x24' }, 0 },
+    { { '\x24', '\xFD', '\xBF', '\xBF', '\xBF', '\xBF' }, 1 },
+    { { '\xC2', '\xA2', '\xC2', '\xA2', '\xA2' }, 4 },
+    { { '\xFE' }, 0 },
+    { { '\x24', '\xFF', '\x24' }, 1 },
+};
+
+malformed_tuple<char16_t> const malformed_u16_test_data[] =
+{
+    { { 0xDC00 }, 0 },
+    { { 0x0024, 0xDFFF }, 1 },
+    { { 0xD800 }, 0 },
+    { { 0xD800, 0x0024 }, 0 },
+    { { 0xD852, 0xDF62, 0xDBFF }, 2 },
+    { { 0xD852, 0xD852, 0xDF62 }, 0 },
+    { { 0xD852, 0xDF62, 0xDF62 }, 2 },
+};
+
+malformed_tuple<char32_t> const malformed_u32_test_data[] =
+{
+    { { 0x80000000 }, 0 },
+    { { 0x00000024, 0xFFFFFFFF }, 1 },
+};
+
 template<typename Ch>
 struct utf_namer {};
 
@@ -415,6 +476,29 @@ char const utf_namer<char16_t>::value[] = "UTF16";
 char const utf_namer<char32_t>::value[] = "UTF32";
 char const utf_namer<wchar_t >::value[] = "UTFW";
 
+// Up to `max_size` random symbols, mostly the 7-bit ones. The surrogates are shifted out when `Utf` can not write them.
+// Up to `corrupt` random units are overwritten with the random values or the surrogates.
+template<
+    typename Utf,
+    typename Text = std::vector<typename Utf::char_type>>
+Text random_text(boost::random::mt19937 & random, uint32_t const max_cp, size_t const corrupt, size_t const max_size = 256)
+{
+    typedef typename Text::value_type ch_type;
+
+    Text buf;
+    auto const write_fn = [&buf] (typename Utf::char_type const ch) { buf.push_back(static_cast<ch_type>(ch)); };
+    for (auto count = random() % max_size; count-- > 0; )
+    {
+        uint32_t cp = random() % 4 ? random() % 0x80 : random() % max_cp;
+        if (utf::utf16::min_surrogate <= cp && cp <= utf::utf16::max_surrogate && !Utf::encodable(cp))
+            cp -= utf::utf16::min_surrogate;
+        Utf::write(cp, write_fn);
+    }
+    for (auto count = random() % (corrupt + 1); count-- > 0 && !buf.empty(); )
+        buf[random() % buf.size()] = static_cast<ch_type>(random() % 2 ? random() : utf::utf16::min_surrogate + random() % 0x800);
+    return buf;
+}
+
 template<
     typename Ch,
     typename Och>
@@ -435,162 +519,2140 @@ void run_conv_test(
     BOOST_TEST_REQUIRE(success);
 }
 
-template<typename Ch>
-void run_size_test(std::basic_string<Ch> const & buf)
+// Runs the test for every instruction set supported by the CPU
+template<typename Fn>
+void for_each_isa(Fn const & fn)
 {
-    size_t total_chars = 0;
-    size_t total_cp = 0;
-    for (auto str = buf.data(); *str;)
+    auto const supported = utf::supported_isa();
+    for (auto level = static_cast<int>(utf::isa::scalar); level <= static_cast<int>(supported); ++level)
     {
-        auto const size = utf::char_size<utf::utf_selector_t<Ch>>(str);
-        BOOST_TEST_REQUIRE(!!size);
-        total_chars += size;
-        ++total_cp;
-        str += size;
+        utf::set_active_isa(static_cast<utf::isa>(level));
+        fn();
     }
-    BOOST_TEST_REQUIRE(buf.size() == total_chars);
+    utf::set_active_isa(supported);
+}
 
-    auto const total_cp1 = utf::size<utf::utf_selector_t<Ch>>(buf.data());
-    BOOST_TEST_REQUIRE(total_cp == total_cp1);
+template<
+    typename Ch,
+    typename Och>
+void run_block_conv_test(
+    std::basic_string<Ch> const & buf,
+    std::basic_string<Och> const & obuf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
 
-    auto const total_cp2 = utf::size<utf::utf_selector_t<Ch>>(buf.cbegin(), buf.cend());
-    BOOST_TEST_REQUIRE(total_cp == total_cp2);
+    // Wrap the symbols with the 7-bit runs of the different length to hit every block boundary
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 7)
+    {
+        std::basic_string<Ch> ibuf;
+        std::basic_string<Och> ebuf;
+        for (size_t n = 0; n < 3; ++n)
+        {
+            ibuf.append(pad_size + n, static_cast<Ch>('a' + n));
+            ebuf.append(pad_size + n, static_cast<Och>('a' + n));
+            if (n < 2)
+            {
+                ibuf += buf;
+                ebuf += obuf;
+            }
+        }
 
-    auto const total_cp3 = utf::size(buf.data());
-    BOOST_TEST_REQUIRE(total_cp == total_cp3);
+        for_each_isa([&ibuf, &ebuf]
+            {
+                std::basic_string<Och> buf_tmp0;
+                utf::conv<utf_type, outf_type>(ibuf.data(), ibuf.data() + ibuf.size(), std::back_inserter(buf_tmp0));
+                std::vector<Och> buf_tmp1(ebuf.size() + 1);
+                auto const eit1 = utf::conv<utf_type, outf_type>(ibuf.data(), ibuf.data() + ibuf.size(), buf_tmp1.data());
+                std::vector<Och> buf_tmp2(ebuf.size());
+                auto const eit2 = utf::conv<utf_type, outf_type>(ibuf.data(), ibuf.data() + ibuf.size(), buf_tmp2.begin());
+                auto const success =
+                    ebuf == buf_tmp0 &&
+                    static_cast<size_t>(eit1 - buf_tmp1.data()) == ebuf.size() &&
+                    std::equal(ebuf.cbegin(), ebuf.cend(), buf_tmp1.cbegin()) &&
+                    eit2 == buf_tmp2.end() &&
+                    std::equal(ebuf.cbegin(), ebuf.cend(), buf_tmp2.cbegin());
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
 
-    auto const total_cp4 = utf::size(buf);
-    BOOST_TEST_REQUIRE(total_cp == total_cp4);
+// The block conversion should produce the same output and throw on the same input as the per-symbol one
+template<
+    typename Ch,
+    typename Och>
+void run_block_conv_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
 
-#if __cpp_lib_string_view >= 201606
-    auto const total_cp5 = utf::size(std::basic_string_view<Ch>(buf.data(), buf.size()));
-    BOOST_TEST_REQUIRE(total_cp == total_cp5);
-#endif
-}
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1);
 
+        std::basic_string<Och> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<utf_type, outf_type>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+        for_each_isa([&buf, &ebuf, &error]
+            {
+                std::basic_string<Och> buf_tmp0;
+                std::vector<Och> buf_tmp1(ebuf.size());
+                auto success = true;
+                try
+                {
+                    utf::conv<utf_type, outf_type>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp0));
+                    auto const eit1 = utf::conv<utf_type, outf_type>(buf.data(), buf.data() + buf.size(), buf_tmp1.data());
+                    success =
+                        error.empty() &&
+                        ebuf == buf_tmp0 &&
+                        eit1 == buf_tmp1.data() + buf_tmp1.size() &&
+                        std::equal(ebuf.cbegin(), ebuf.cend(), buf_tmp1.cbegin());
+                }
+                catch (std::runtime_error const & e)
+                {
+                    success = error == e.what();
+                }
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
 }
 
-BOOST_DATA_TEST_CASE(conv_u8_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u8 ); }
-BOOST_DATA_TEST_CASE(conv_u8_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u16); }
-BOOST_DATA_TEST_CASE(conv_u8_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u32); }
-BOOST_DATA_TEST_CASE(conv_u8_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.uw ); }
-BOOST_DATA_TEST_CASE(conv_u16_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u8 ); }
-BOOST_DATA_TEST_CASE(conv_u16_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u16); }
-BOOST_DATA_TEST_CASE(conv_u16_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u32); }
-BOOST_DATA_TEST_CASE(conv_u16_to_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.uw ); }
-BOOST_DATA_TEST_CASE(conv_u32_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u8 ); }
-BOOST_DATA_TEST_CASE(conv_u32_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u16); }
-BOOST_DATA_TEST_CASE(conv_u32_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u32); }
-BOOST_DATA_TEST_CASE(conv_u32_to_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.uw ); }
-BOOST_DATA_TEST_CASE(conv_uw_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u8 ); }
-BOOST_DATA_TEST_CASE(conv_uw_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u16); }
-BOOST_DATA_TEST_CASE(conv_uw_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u32); }
-BOOST_DATA_TEST_CASE(conv_uw_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.uw ); }
-
-BOOST_DATA_TEST_CASE(conv_u32_to_u8_supported, boost::make_iterator_range(supported_test_data), tuple) { run_conv_test(tuple.u32, tuple.u8 ); }
-BOOST_DATA_TEST_CASE(conv_u8_to_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u32); }
+template<
+    typename Ch,
+    typename Och>
+void run_conv_into_test(
+    std::basic_string<Ch> const & buf,
+    std::basic_string<Och> const & obuf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
 
-BOOST_DATA_TEST_CASE(size_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u8 ); }
-BOOST_DATA_TEST_CASE(size_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u16); }
-BOOST_DATA_TEST_CASE(size_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u32); }
-BOOST_DATA_TEST_CASE(size_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.uw ); }
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 23)
+    {
+        std::basic_string<Ch> ibuf;
+        std::basic_string<Och> ebuf;
+        for (size_t n = 0; n < 3; ++n)
+        {
+            ibuf.append(pad_size + n, static_cast<Ch>('a' + n));
+            ebuf.append(pad_size + n, static_cast<Och>('a' + n));
+            if (n < 2)
+            {
+                ibuf += buf;
+                ebuf += obuf;
+            }
+        }
 
-BOOST_DATA_TEST_CASE(size_u8_supported , boost::make_iterator_range(supported_test_data), tuple) { run_size_test(tuple.u8 ); }
-BOOST_DATA_TEST_CASE(size_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_size_test(tuple.u32); }
+        // The input and output offsets of every symbol boundary
+        std::vector<std::pair<size_t, size_t>> bounds(1);
+        {
+            auto it = ibuf.cbegin();
+            size_t size = 0;
+            while (it != ibuf.cend())
+            {
+                outf_type::write(utf_type::read([&it] { return *it++; }), [&size] (typename outf_type::char_type) { ++size; });
+                bounds.emplace_back(static_cast<size_t>(it - ibuf.cbegin()), size);
+            }
+        }
 
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<char>, utf::utf_selector_t<unsigned char>>::value);
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<char>, utf::utf_selector_t<signed   char>>::value);
+        for_each_isa([&ibuf, &ebuf, &bounds]
+            {
+                static size_t const guard_size = 32;
+                static Och const guard = static_cast<Och>(0x55);
 
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<signed char>, utf::utf_selector_t<         char>>::value);
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<signed char>, utf::utf_selector_t<unsigned char>>::value);
+                auto success = true;
+                for (size_t size = 0; success && size <= ebuf.size() + 1; ++size)
+                {
+                    auto const bound = *(std::upper_bound(bounds.cbegin(), bounds.cend(), size,
+                        [] (size_t const value, std::pair<size_t, size_t> const & item) { return value < item.second; }) - 1);
+
+                    std::vector<Och> buf_tmp0(size + guard_size, guard);
+                    auto const res0 = utf::conv_into<utf_type, outf_type>(ibuf.data(), ibuf.data() + ibuf.size(), buf_tmp0.data(), buf_tmp0.data() + size);
+                    std::vector<Och> buf_tmp1(size);
+                    auto const res1 = utf::conv_into<utf_type, outf_type>(ibuf.cbegin(), ibuf.cend(), buf_tmp1.begin(), buf_tmp1.end());
+                    success =
+                        static_cast<size_t>(res0.in - ibuf.data()) == bound.first &&
+                        static_cast<size_t>(res0.out - buf_tmp0.data()) == bound.second &&
+                        std::equal(buf_tmp0.cbegin(), buf_tmp0.cbegin() + bound.second, ebuf.cbegin()) &&
+                        std::all_of(buf_tmp0.cbegin() + size, buf_tmp0.cend(), [] (Och const ch) { return ch == guard; }) &&
+                        static_cast<size_t>(res1.in - ibuf.cbegin()) == bound.first &&
+                        static_cast<size_t>(res1.out - buf_tmp1.begin()) == bound.second &&
+                        std::equal(buf_tmp1.cbegin(), buf_tmp1.cbegin() + bound.second, ebuf.cbegin());
+                }
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
 
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<unsigned char>, utf::utf_selector_t<       char>>::value);
-BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<unsigned char>, utf::utf_selector_t<signed char>>::value);
+template<typename Ch>
+void run_validate_test(std::basic_string<Ch> const & buf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
 
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<         char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<signed   char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<unsigned char>>::value);
+    auto const success =
+        utf::validate<utf_type>(buf.cbegin(), buf.cend()) == buf.cend() &&
+        utf::validate<utf_type>(buf.data(), buf.data() + buf.size()) == buf.data() + buf.size() &&
+        utf::validate<utf_type>(buf.data()) == buf.data() + buf.size() &&
+        utf::is_valid<utf_type>(buf.cbegin(), buf.cend()) &&
+        utf::is_valid<utf_type>(buf.data()) &&
+        utf::is_valid(buf.data()) &&
+        utf::is_valid(buf)
+#if __cpp_lib_string_view >= 201606
+        && utf::is_valid(std::basic_string_view<Ch>(buf.data(), buf.size()))
+#endif
+        ;
+    BOOST_TEST_REQUIRE(success);
+}
 
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<         char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<signed   char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<unsigned char>>::value);
+template<typename Ch>
+void run_validate_error_test(malformed_tuple<Ch> const & tuple)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
 
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<char32_t>>::value);
+    // Move the malformed symbol over the block boundaries
+    for (size_t pad_size = 0; pad_size < 80; ++pad_size)
+    {
+        std::basic_string<Ch> buf(pad_size, static_cast<Ch>('a'));
+        buf += tuple.buf;
+        auto const offset = pad_size + tuple.offset;
+        auto const success =
+            static_cast<size_t>(utf::validate<utf_type>(buf.cbegin(), buf.cend()) - buf.cbegin()) == offset &&
+            static_cast<size_t>(utf::validate<utf_type>(buf.data()) - buf.data()) == offset &&
+            !utf::is_valid(buf);
+        BOOST_TEST_REQUIRE(success);
+
+        auto padded = buf;
+        padded.append(pad_size, static_cast<Ch>('b'));
+        for_each_isa([&buf, &padded, offset]
+            {
+                auto const success_contiguous =
+                    static_cast<size_t>(utf::validate<utf_type>(buf.data(), buf.data() + buf.size()) - buf.data()) == offset &&
+                    static_cast<size_t>(utf::validate<utf_type>(padded.data(), padded.data() + padded.size()) - padded.data()) == offset;
+                BOOST_TEST_REQUIRE(success_contiguous);
+            });
+    }
+}
 
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<         char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<signed   char>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<unsigned char>>::value);
+// The offset of the first symbol `Utf::read` fails on
+template<
+    typename Utf,
+    typename Ch>
+size_t reference_valid_size(std::basic_string<Ch> const & buf)
+{
+    auto it = buf.cbegin();
+    auto const eit = buf.cend();
+    auto const read_fn = [&it, &eit]
+        {
+            if (it == eit)
+                throw std::runtime_error("Not enough input");
+            return *it++;
+        };
+    size_t valid_size = 0;
+    try
+    {
+        while (it != eit)
+        {
+            Utf::read(read_fn);
+            valid_size = it - buf.cbegin();
+        }
+    }
+    catch (std::runtime_error const &)
+    {
+    }
+    return valid_size;
+}
 
-#if defined(_WIN32)
+template<typename Ch>
+void run_validate_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
 
-BOOST_STATIC_ASSERT( std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char16_t>>::value);
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char32_t>>::value);
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 4096; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1, 128);
+
+        auto const offset = reference_valid_size<utf_type>(buf);
+        auto const success =
+            static_cast<size_t>(utf::validate<utf_type>(buf.cbegin(), buf.cend()) - buf.cbegin()) == offset;
+        BOOST_TEST_REQUIRE(success);
+        for_each_isa([&buf, offset]
+            {
+                auto const success_contiguous =
+                    static_cast<size_t>(utf::validate<utf_type>(buf.data(), buf.data() + buf.size()) - buf.data()) == offset;
+                BOOST_TEST_REQUIRE(success_contiguous);
+            });
+    }
+}
 
-#elif defined(__linux__) || defined(__APPLE__)
+template<
+    typename Ch,
+    typename Och>
+void run_error_policy_test(
+    std::basic_string<Ch> const & buf,
+    std::basic_string<Och> const & replaced,
+    std::basic_string<Och> const & skipped,
+    size_t const offset,
+    utf::utf_error const error)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
 
-BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char16_t>>::value);
-BOOST_STATIC_ASSERT( std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char32_t>>::value);
+    auto const replaced_size = utf::size<outf_type>(replaced.cbegin(), replaced.cend());
+    auto const skipped_size = utf::size<outf_type>(skipped.cbegin(), skipped.cend());
 
-#else
-#error Unknown platform
-#endif
+    // Move the malformed symbols over the block boundaries
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 3)
+    {
+        std::basic_string<Ch> ibuf(pad_size, static_cast<Ch>('a'));
+        ibuf += buf;
+        std::basic_string<Och> pad(pad_size, static_cast<Och>('a'));
+
+        auto success =
+            utf::conv<Och, utf::error_replace>(ibuf) == pad + replaced &&
+            utf::conv<Och, utf::error_skip>(ibuf) == pad + skipped &&
+            utf::convz<Och, utf::error_replace>(ibuf.c_str()) == pad + replaced;
+        BOOST_TEST_REQUIRE(success);
+
+        // `size` knows nothing about the output encoding
+        if (error != utf::utf_error::invalid_code_point)
+        {
+            auto const size_status = utf::size<utf_type, utf::error_stop>(ibuf.cbegin(), ibuf.cend());
+            auto const success_size =
+                utf::size<utf_type, utf::error_replace>(ibuf.cbegin(), ibuf.cend()) == pad_size + replaced_size &&
+                utf::size<utf_type, utf::error_skip>(ibuf.c_str()) == pad_size + skipped_size &&
+                static_cast<size_t>(size_status.in - ibuf.cbegin()) == pad_size + offset &&
+                size_status.error == error;
+            BOOST_TEST_REQUIRE(success_size);
+        }
 
-namespace {
+        for_each_isa([&ibuf, &pad, &replaced, &skipped, offset, error]
+            {
+                std::basic_string<Och> buf_tmp0;
+                utf::conv<utf_type, outf_type, utf::error_replace>(ibuf.data(), ibuf.data() + ibuf.size(), std::back_inserter(buf_tmp0));
+                std::basic_string<Och> buf_tmp1;
+                utf::conv<utf_type, outf_type, utf::error_skip>(ibuf.cbegin(), ibuf.cend(), std::back_inserter(buf_tmp1));
+                std::basic_string<Och> buf_tmp2;
+                auto const status2 = utf::conv<utf_type, outf_type, utf::error_stop>(ibuf.data(), ibuf.data() + ibuf.size(), std::back_inserter(buf_tmp2));
+                std::basic_string<Och> buf_tmp3;
+                auto const status3 = utf::convz<utf_type, outf_type, utf::error_stop>(ibuf.cbegin(), std::back_inserter(buf_tmp3));
+                auto const success_policy =
+                    buf_tmp0 == pad + replaced &&
+                    buf_tmp1 == pad + skipped &&
+                    static_cast<size_t>(status2.in - ibuf.data()) == pad.size() + offset &&
+                    status2.error == error &&
+                    static_cast<size_t>(status3.in - ibuf.cbegin()) == pad.size() + offset &&
+                    status3.error == error &&
+                    buf_tmp2 == buf_tmp3 &&
+                    buf_tmp2 == utf::conv<Och>(ibuf.substr(0, pad.size() + offset));
+                BOOST_TEST_REQUIRE(success_policy);
+            });
+    }
+}
 
-uint64_t get_time() throw()
+// The contiguous input is validated block by block, the result should be the same as for the symbol by symbol
+// conversion, and exactly the same symbols as for `error_throw` should be malformed
+template<
+    typename Ch,
+    typename Och>
+void run_error_policy_random_test(uint32_t const max_cp)
 {
-#if defined(_MSC_VER)
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
 
-#if defined(_M_IX86) || defined(_M_X64)
-    // Note: CPUID can be executed at any privilege level to serialize instruction execution. Serializing instruction
-    //       execution guarantees that any modifications to flags, registers, and memory for previous instructions are
-    //       completed before the next instruction is fetched and executed.
-    int cpu_info[4];
-    __cpuid(cpu_info, 0);
-    return __rdtsc();
-#elif defined(_M_ARM64)
-    return _ReadStatusReg(ARM64_CNTVCT);
-#else
-#error Unsupported architecture
-#endif
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 3);
 
-#elif defined(__GNUC__) // Clang also defines __GNUC__ for compatibility with GCC.
+        std::basic_string<Och> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<utf_type, outf_type>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
 
-#if defined(__i386__) || defined(__x86_64__)
-    uint32_t lo, hi;
-    asm volatile(
-        "cpuid\n\t"
-        "rdtsc\n\t"
-        : "=a"(lo), "=d"(hi) : "a"(0) :
-#if defined(__i386__)
-        "%ebx", "%ecx"
-#else
-        "%rbx", "%rcx"
-#endif
-        );
-    return static_cast<uint64_t>(hi) << 32 | lo;
-#elif defined(__aarch64__)
-    uint64_t cntvct_el0;
-    asm volatile(
-        "mrs %0, cntvct_el0\n\t"
-        : "=r" (cntvct_el0) : : );
-    return cntvct_el0;
-#elif defined(_POSIX_MONOTONIC_CLOCK) && _POSIX_MONOTONIC_CLOCK >= 0
-    struct timespec tp;
-    if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0)
-        std::abort();
-    return static_cast<uint64_t>(tp.tv_sec) * 1000000000ull + tp.tv_nsec;
-#else
-#error Unsupported architecture
-#endif
+        std::basic_string<Och> replaced;
+        utf::conv<utf_type, outf_type, utf::error_replace>(buf.cbegin(), buf.cend(), std::back_inserter(replaced));
+        std::basic_string<Och> skipped;
+        utf::conv<utf_type, outf_type, utf::error_skip>(buf.cbegin(), buf.cend(), std::back_inserter(skipped));
+        std::basic_string<Och> stopped;
+        auto const status = utf::conv<utf_type, outf_type, utf::error_stop>(buf.cbegin(), buf.cend(), std::back_inserter(stopped));
+        auto const success =
+            error.empty() == (status.error == utf::utf_error::none) &&
+            (!error.empty() || (replaced == ebuf && skipped == ebuf && stopped == ebuf && status.in == buf.cend()));
+        BOOST_TEST_REQUIRE(success);
+
+        for_each_isa([&buf, &replaced, &skipped, &stopped, &status]
+            {
+                std::basic_string<Och> buf_tmp0;
+                utf::conv<utf_type, outf_type, utf::error_replace>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp0));
+                std::basic_string<Och> buf_tmp1;
+                utf::conv<utf_type, outf_type, utf::error_skip>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp1));
+                std::basic_string<Och> buf_tmp2;
+                auto const status2 = utf::conv<utf_type, outf_type, utf::error_stop>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp2));
+                auto const success_contiguous =
+                    buf_tmp0 == replaced &&
+                    buf_tmp1 == skipped &&
+                    buf_tmp2 == stopped &&
+                    status2.in - buf.data() == status.in - buf.cbegin() &&
+                    status2.error == status.error;
+                BOOST_TEST_REQUIRE(success_contiguous);
+            });
+    }
+}
 
-#else
-#error Unknown compiler
-#endif
+template<
+    typename Ch,
+    typename Och>
+void run_transcoder_test(
+    std::basic_string<Ch> const & buf,
+    std::basic_string<Och> const & obuf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    // Cut the input at every position
+    for (size_t pos = 0; pos <= buf.size(); ++pos)
+    {
+        utf::basic_transcoder<utf_type, outf_type> transcoder;
+        std::basic_string<Och> buf_tmp;
+        transcoder.feed(buf.data(), buf.data() + pos, std::back_inserter(buf_tmp));
+        transcoder.feed(buf.substr(pos), std::back_inserter(buf_tmp));
+        auto const success =
+            transcoder.pending() == 0 &&
+            buf_tmp == obuf;
+        transcoder.finish();
+        BOOST_TEST_REQUIRE(success);
+    }
 }
 
-#if defined(__linux__) || defined(__APPLE__)
-void current_utc_time(timespec * ts)
+// The chunked conversion should produce the same output as `conv` and fail on the same input
+template<
+    typename Ch,
+    typename Och>
+void run_transcoder_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1);
+        if (!buf.empty() && random() % 4 == 0)
+            buf.pop_back();
+
+        std::basic_string<Och> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<utf_type, outf_type>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+
+        for_each_isa([&buf, &ebuf, &error, &random]
+            {
+                utf::basic_transcoder<utf_type, outf_type> transcoder;
+                std::basic_string<Och> buf_tmp;
+                std::string error_tmp;
+                try
+                {
+                    for (size_t pos = 0; pos < buf.size(); )
+                    {
+                        auto const size = std::min<size_t>(random() % 8, buf.size() - pos);
+                        transcoder.feed(buf.data() + pos, buf.data() + pos + size, std::back_inserter(buf_tmp));
+                        pos += size;
+                    }
+                    transcoder.finish();
+                }
+                catch (std::runtime_error const & e)
+                {
+                    error_tmp = e.what();
+                }
+                auto const success =
+                    error == error_tmp &&
+                    (!error.empty() || buf_tmp == ebuf);
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
+
+// The parallel conversion should produce the same output and throw the same error as `conv` for every chunk size
+template<
+    typename Ch,
+    typename Och>
+void run_parallel_conv_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    utf::thread_executor const executor(4);
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 256; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 3, 1024);
+
+        std::basic_string<Och> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<utf_type, outf_type>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+
+        for (size_t const chunk_size : { 1, 7, 64, 1024 })
+        {
+            std::vector<Och> buf_tmp(1, static_cast<Och>('a'));
+            auto success = true;
+            try
+            {
+                utf::parallel_conv<utf_type, outf_type>(buf.data(), buf.data() + buf.size(), buf_tmp, executor, chunk_size);
+                success =
+                    error.empty() &&
+                    buf_tmp.size() == ebuf.size() + 1 &&
+                    std::equal(ebuf.cbegin(), ebuf.cend(), buf_tmp.cbegin() + 1);
+            }
+            catch (std::runtime_error const & e)
+            {
+                success = error == e.what() && buf_tmp.size() == 1;
+            }
+            BOOST_TEST_REQUIRE(success);
+        }
+    }
+}
+
+template<
+    typename Ch,
+    typename Och>
+void run_batch_conv_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 64; ++n)
+    {
+        std::vector<std::basic_string<Ch>> values(random() % 64);
+        for (auto & value : values)
+        {
+            auto const max_size = random() % 4 ? 16 : 256;
+            value = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 0, max_size);
+        }
+        if (random() % 2 && !values.empty())
+        {
+            auto & value = values[random() % values.size()];
+            if (!value.empty())
+                value[random() % value.size()] = static_cast<Ch>(random());
+        }
+
+        std::basic_string<Ch> data;
+        std::vector<int32_t> offsets(1, 0);
+        std::vector<std::basic_string<Och>> replaced;
+        std::vector<std::basic_string<Och>> converted;
+        std::string error;
+        for (auto const & value : values)
+        {
+            data += value;
+            offsets.push_back(static_cast<int32_t>(data.size()));
+            replaced.push_back(utf::conv<Och, utf::error_replace>(value));
+            try
+            {
+                converted.push_back(utf::conv<Och>(value));
+            }
+            catch (std::runtime_error const & e)
+            {
+                if (error.empty())
+                    error = e.what();
+            }
+        }
+
+        auto const check = [&values] (
+            std::vector<std::basic_string<Och>> const & expected,
+            std::basic_string<Och> const & res_data,
+            std::vector<size_t> const & res_offsets)
+            {
+                auto success = res_offsets.size() == values.size() + 1 && res_offsets[0] == 0 && res_offsets.back() == res_data.size();
+                for (size_t m = 0; success && m < values.size(); ++m)
+                    success = res_data.compare(res_offsets[m], res_offsets[m + 1] - res_offsets[m], expected[m]) == 0;
+                return success;
+            };
+
+        std::basic_string<Och> res_data(1, static_cast<Och>('a'));
+        std::vector<size_t> res_offsets(1, 1);
+        utf::batch_conv<utf_type, outf_type, utf::error_replace>(data.data(), offsets.data(), values.size(), res_data, res_offsets);
+        BOOST_TEST_REQUIRE(check(replaced, res_data, res_offsets));
+
+        res_data.assign(1, static_cast<Och>('a'));
+        try
+        {
+            utf::batch_conv(values.cbegin(), values.cend(), res_data, res_offsets);
+            auto const success = error.empty() && check(converted, res_data, res_offsets);
+            BOOST_TEST_REQUIRE(success);
+        }
+        catch (std::runtime_error const & e)
+        {
+            auto const success = error == e.what() && res_data.empty() && res_offsets.empty();
+            BOOST_TEST_REQUIRE(success);
+        }
+    }
+}
+
+template<
+    typename Ch,
+    typename Och>
+void run_converted_size_test(
+    std::basic_string<Ch> const & buf,
+    std::basic_string<Och> const & obuf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    for_each_isa([&buf, &obuf]
+        {
+            auto const success =
+                utf::converted_size<utf_type, outf_type>(buf.cbegin(), buf.cend()) == obuf.size() &&
+                utf::converted_size<utf_type, outf_type>(buf.data(), buf.data() + buf.size()) == obuf.size() &&
+                utf::converted_sizez<utf_type, outf_type>(buf.cbegin()) == obuf.size() &&
+                utf::converted_sizez<outf_type>(buf.data()) == obuf.size() &&
+                utf::converted_size<outf_type>(buf) == obuf.size();
+            BOOST_TEST_REQUIRE(success);
+        });
+}
+
+// The converted size should match the output and the errors of the conversion
+template<
+    typename Ch,
+    typename Och>
+void run_converted_size_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+    typedef utf::utf_selector_t<Och> outf_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1);
+
+        for (auto const z : {false, true})
+        {
+            size_t size = 0;
+            std::string error;
+            try
+            {
+                std::basic_string<Och> obuf;
+                if (z)
+                    utf::convz<utf_type, outf_type>(buf.cbegin(), std::back_inserter(obuf));
+                else
+                    utf::conv<utf_type, outf_type>(buf.cbegin(), buf.cend(), std::back_inserter(obuf));
+                size = obuf.size();
+            }
+            catch (std::runtime_error const & e)
+            {
+                error = e.what();
+            }
+            for_each_isa([&buf, z, size, &error]
+                {
+                    auto success = true;
+                    try
+                    {
+                        auto const size_tmp = z
+                            ? utf::converted_sizez<utf_type, outf_type>(buf.data())
+                            : utf::converted_size<utf_type, outf_type>(buf.data(), buf.data() + buf.size());
+                        success = error.empty() && size == size_tmp;
+                    }
+                    catch (std::runtime_error const & e)
+                    {
+                        success = error == e.what();
+                    }
+                    BOOST_TEST_REQUIRE(success);
+                });
+        }
+    }
+}
+
+// The bulk counting of the contiguous input should throw the same errors as the scalar one
+template<typename Ch>
+void run_size_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1);
+        if (!buf.empty() && random() % 2)
+            buf.resize(random() % buf.size());
+
+        for (auto const z : {false, true})
+        {
+            size_t size = 0;
+            std::string error;
+            try
+            {
+                size = z
+                    ? utf::size<utf_type>(buf.cbegin())
+                    : utf::size<utf_type>(buf.cbegin(), buf.cend());
+            }
+            catch (std::runtime_error const & e)
+            {
+                error = e.what();
+            }
+            for_each_isa([&buf, z, size, &error]
+                {
+                    auto success = true;
+                    try
+                    {
+                        auto const size_tmp = z
+                            ? utf::size(buf.c_str())
+                            : utf::size(buf);
+                        success = error.empty() && size == size_tmp;
+                    }
+                    catch (std::runtime_error const & e)
+                    {
+                        success = error == e.what();
+                    }
+                    BOOST_TEST_REQUIRE(success);
+                });
+        }
+    }
+}
+
+// Every code point and every unit should be found by the index for every step
+template<typename Ch>
+void run_cp_index_test(std::basic_string<Ch> const & buf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+
+    std::vector<size_t> offsets;
+    std::vector<size_t> cps;
+    for (size_t offset = 0; offset != buf.size(); )
+    {
+        auto const size = utf::char_size<utf_type>(buf.data() + offset);
+        for (size_t n = 0; n < size; ++n)
+            cps.push_back(offsets.size());
+        offsets.push_back(offset);
+        offset += size;
+    }
+    offsets.push_back(buf.size());
+    cps.push_back(offsets.size() - 1);
+
+    for_each_isa([&buf, &offsets, &cps]
+        {
+            for (size_t const step : { 1, 3, 64 })
+            {
+                auto const index = utf::make_cp_index(buf, step);
+                auto success =
+                    index.size() == offsets.size() - 1 &&
+                    index.units() == buf.size() &&
+                    index.marks() == (index.size() + step - 1) / step;
+                for (size_t n = 0; n < offsets.size(); ++n)
+                    success = success && index.offset(n) == offsets[n];
+                for (size_t n = 0; n < cps.size(); ++n)
+                    success = success && index.code_point(n) == cps[n];
+                BOOST_TEST_REQUIRE(success);
+            }
+        });
+}
+
+template<typename Ch>
+void run_cp_index_random_test(uint32_t const max_cp)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 256; ++n)
+    {
+        auto const buf = random_text<utf_type, std::basic_string<Ch>>(random, max_cp, 1, 4096);
+
+        std::string error;
+        try
+        {
+            utf::converted_size<utf_type, typename std::conditional<std::is_same<utf_type, utf::utf32>::value, utf::utf8, utf::utf32>::type>(
+                buf.cbegin(), buf.cend());
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+        if (error.empty())
+            run_cp_index_test(buf);
+        else
+            for_each_isa([&buf, &error]
+                {
+                    auto success = true;
+                    try
+                    {
+                        utf::make_cp_index(buf, 5);
+                        success = false;
+                    }
+                    catch (std::runtime_error const & e)
+                    {
+                        success = error == e.what();
+                    }
+                    BOOST_TEST_REQUIRE(success);
+                });
+    }
+}
+
+// Every UTF-8 offset and every UTF-16 offset should be translated one by one and in batch, the offsets inside the
+// symbols are rounded down
+void run_offsets_test(std::string const & u8)
+{
+    std::vector<size_t> u16_offsets;
+    std::vector<size_t> u8_offsets;
+    size_t u16_offset = 0;
+    for (size_t offset = 0; offset != u8.size(); )
+    {
+        auto const size = utf::char_size<utf::utf8>(u8.data() + offset);
+        auto const begin = u8.cbegin() + offset;
+        auto const units = utf::converted_size<utf::utf8, utf::utf16>(begin, begin + size);
+        for (size_t n = 0; n < size; ++n)
+            u16_offsets.push_back(u16_offset);
+        for (size_t n = 0; n < units; ++n)
+            u8_offsets.push_back(offset);
+        offset += size;
+        u16_offset += units;
+    }
+    u16_offsets.push_back(u16_offset);
+    u8_offsets.push_back(u8.size());
+
+    for_each_isa([&u8, &u16_offsets, &u8_offsets]
+        {
+            auto success = true;
+            for (size_t n = 0; n < u16_offsets.size(); ++n)
+                success = success && utf::utf8_to_utf16_offset(u8, n) == u16_offsets[n];
+            for (size_t n = 0; n < u8_offsets.size(); ++n)
+                success = success && utf::utf16_to_utf8_offset(u8, n) == u8_offsets[n];
+
+            std::vector<size_t> offsets(std::max(u16_offsets.size(), u8_offsets.size()));
+            for (size_t n = 0; n < offsets.size(); ++n)
+                offsets[n] = n;
+            std::vector<size_t> res;
+            utf::utf8_to_utf16_offsets(u8.data(), u8.data() + u8.size(), offsets.cbegin(), offsets.cbegin() + u16_offsets.size(), std::back_inserter(res));
+            success = success && res == u16_offsets;
+            res.clear();
+            utf::utf16_to_utf8_offsets(u8.data(), u8.data() + u8.size(), offsets.cbegin(), offsets.cbegin() + u8_offsets.size(), std::back_inserter(res));
+            success = success && res == u8_offsets;
+            BOOST_TEST_REQUIRE(success);
+
+            BOOST_CHECK_THROW(utf::utf8_to_utf16_offset(u8, u16_offsets.size()), std::out_of_range);
+            BOOST_CHECK_THROW(utf::utf16_to_utf8_offset(u8, u8_offsets.size()), std::out_of_range);
+        });
+}
+
+// The code points should be the same forward and backward
+template<typename Ch>
+void run_codepoint_view_test(std::basic_string<Ch> const & buf, std::u32string const & u32)
+{
+    auto const view = utf::make_codepoint_view(buf);
+    std::u32string forward;
+    for (auto const cp : view)
+        forward.push_back(static_cast<char32_t>(cp));
+    std::u32string backward;
+    for (auto it = view.end(); it != view.begin(); )
+        backward.push_back(static_cast<char32_t>(*--it));
+    std::reverse(backward.begin(), backward.end());
+    auto const success =
+        forward == u32 &&
+        backward == u32 &&
+        view.empty() == u32.empty() &&
+        static_cast<size_t>(std::distance(view.begin(), view.end())) == u32.size();
+    BOOST_TEST_REQUIRE(success);
+}
+
+// Decoding from the end should give the same symbols in the reverse order
+template<typename Ch>
+void run_read_back_test(std::basic_string<Ch> const & buf, std::u32string const & u32)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+
+    std::u32string res;
+    std::vector<size_t> sizes;
+    for (auto it = buf.data() + buf.size(); it != buf.data(); )
+    {
+        auto size_it = it;
+        auto const size = utf_type::char_size_back([&size_it] { return *--size_it; });
+        auto const prev = utf::prev_boundary<utf_type>(buf.data(), it);
+        res.push_back(static_cast<char32_t>(utf_type::read_back([&it] { return *--it; })));
+        sizes.push_back(size);
+        BOOST_TEST_REQUIRE((prev == it && utf::char_size<utf_type>(it) == size));
+    }
+    std::reverse(res.begin(), res.end());
+    BOOST_TEST_REQUIRE((res == u32));
+
+    std::u32string back;
+    utf::conv_back<utf::utf32>(buf, std::back_inserter(back));
+    std::reverse(back.begin(), back.end());
+    std::basic_string<Ch> back_same;
+    utf::conv_back<utf_type, utf_type>(buf.data(), buf.data() + buf.size(), std::back_inserter(back_same));
+    auto const success =
+        back == u32 &&
+        back_same.size() == buf.size();
+    BOOST_TEST_REQUIRE(success);
+}
+
+// Every limit should cut the input at the last symbol boundary which fits
+template<typename Ch>
+void run_truncate_test(std::basic_string<Ch> const & buf)
+{
+    typedef utf::utf_selector_t<Ch> utf_type;
+
+    std::vector<size_t> bounds(1, 0);
+    while (bounds.back() != buf.size())
+        bounds.push_back(bounds.back() + utf::char_size<utf_type>(buf.data() + bounds.back()));
+
+    for_each_isa([&buf, &bounds]
+        {
+            auto const first = buf.data();
+            auto const last = buf.data() + buf.size();
+            auto success = true;
+            for (size_t n = 0; n <= buf.size() + 1; ++n)
+            {
+                auto const expected = *(std::upper_bound(bounds.cbegin(), bounds.cend(), n) - 1);
+                success = success && utf::truncate<utf_type>(first, last, n) == first + expected;
+            }
+            for (size_t n = 0; n <= bounds.size(); ++n)
+            {
+                auto const expected = bounds[std::min(n, bounds.size() - 1)];
+                success = success &&
+                    utf::truncate_codepoints<utf_type>(first, last, n) == first + expected &&
+                    utf::truncate_codepoints<utf_type>(buf.cbegin(), buf.cend(), n) == buf.cbegin() + expected;
+            }
+            BOOST_TEST_REQUIRE(success);
+        });
+}
+
+typedef utf::utf_swapped<utf::utf16> swapped_u16;
+typedef utf::utf_swapped<utf::utf32> swapped_u32;
+
+template<typename Utf>
+std::vector<typename Utf::char_type> encode(std::u32string const & u32)
+{
+    std::vector<typename Utf::char_type> res;
+    for (auto const cp : u32)
+        Utf::write(cp, [&res] (typename Utf::char_type const ch) { res.push_back(ch); });
+    return res;
+}
+
+// The byte swapped codecs are converted in bulk through the native kernels and should produce exactly the same output
+template<
+    typename Utf,
+    typename Outf>
+void run_swapped_conv_test(std::u32string const & u32)
+{
+    typedef typename Outf::char_type och_type;
+
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 7)
+    {
+        std::u32string text;
+        for (size_t n = 0; n < 3; ++n)
+        {
+            text.append(pad_size + n, static_cast<char32_t>('a' + n));
+            if (n < 2)
+                text += u32;
+        }
+        auto const ibuf = encode<Utf>(text);
+        auto const ebuf = encode<Outf>(text);
+
+        // The same units at the odd offset of the byte buffer
+        std::vector<unsigned char> bytes(1 + ibuf.size() * sizeof(typename Utf::char_type));
+        if (!ibuf.empty())
+            std::memcpy(bytes.data() + 1, ibuf.data(), ibuf.size() * sizeof(typename Utf::char_type));
+        utf::byte_unit_iterator<typename Utf::char_type> const first(bytes.data() + 1);
+        std::vector<och_type> buf_bytes;
+        utf::conv<Utf, Outf>(first, first + ibuf.size(), std::back_inserter(buf_bytes));
+        BOOST_TEST_REQUIRE((buf_bytes == ebuf));
+
+        for_each_isa([&ibuf, &ebuf]
+            {
+                std::vector<och_type> buf_tmp0;
+                utf::conv<Utf, Outf>(ibuf.data(), ibuf.data() + ibuf.size(), std::back_inserter(buf_tmp0));
+                std::vector<och_type> buf_tmp1(ebuf.size() + 1);
+                auto const eit1 = utf::conv<Utf, Outf>(ibuf.data(), ibuf.data() + ibuf.size(), buf_tmp1.data());
+                auto const success =
+                    ebuf == buf_tmp0 &&
+                    static_cast<size_t>(eit1 - buf_tmp1.data()) == ebuf.size() &&
+                    std::equal(ebuf.cbegin(), ebuf.cend(), buf_tmp1.cbegin());
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
+
+template<
+    typename Utf,
+    typename Outf>
+void run_swapped_conv_random_test(uint32_t const max_cp)
+{
+    typedef typename Outf::char_type och_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<Utf>(random, max_cp, 1);
+
+        std::vector<och_type> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<Utf, Outf>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+        for_each_isa([&buf, &ebuf, &error]
+            {
+                std::vector<och_type> buf_tmp;
+                auto success = true;
+                try
+                {
+                    utf::conv<Utf, Outf>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp));
+                    success = error.empty() && ebuf == buf_tmp;
+                }
+                catch (std::runtime_error const & e)
+                {
+                    success = error == e.what();
+                }
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
+
+template<
+    typename Utf,
+    typename Outf,
+    typename It>
+std::pair<std::basic_string<typename Outf::char_type>, std::string> try_conv(It const it, It const eit)
+{
+    std::basic_string<typename Outf::char_type> res;
+    std::string error;
+    try
+    {
+        utf::conv<Utf, Outf>(it, eit, std::back_inserter(res));
+    }
+    catch (std::runtime_error const & e)
+    {
+        error = e.what();
+    }
+    return std::make_pair(res, error);
+}
+
+// The automaton should write, count and reject exactly the same as `utf8` does, both symbol by symbol and in bulk
+template<typename Outf>
+void run_utf8_dfa_random_test(uint32_t const max_cp)
+{
+    typedef typename Outf::char_type och_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<utf::utf8>(random, max_cp, 3);
+        auto const it = buf.data();
+        auto const eit = buf.data() + buf.size();
+
+        auto const expected = try_conv<utf::utf8, Outf>(buf.cbegin(), buf.cend());
+        auto const success =
+            try_conv<utf::utf8_dfa, Outf>(buf.cbegin(), buf.cend()) == expected &&
+            utf::validate<utf::utf8_dfa>(buf.cbegin(), buf.cend()) == utf::validate<utf::utf8>(buf.cbegin(), buf.cend());
+        BOOST_TEST_REQUIRE(success);
+
+        std::basic_string<och_type> replaced;
+        utf::conv<utf::utf8, Outf, utf::error_replace>(buf.cbegin(), buf.cend(), std::back_inserter(replaced));
+        std::basic_string<och_type> stopped;
+        auto const status = utf::conv<utf::utf8, Outf, utf::error_stop>(buf.cbegin(), buf.cend(), std::back_inserter(stopped));
+
+        for_each_isa([it, eit, &expected, &replaced, &stopped, &status, &buf]
+            {
+                std::vector<och_type> buf_tmp0(buf.size() + utf::detail::block_conv<utf::utf8_dfa, Outf>::overrun);
+                std::string error0;
+                size_t size0 = 0;
+                try
+                {
+                    size0 = static_cast<size_t>(utf::conv<utf::utf8_dfa, Outf>(it, eit, buf_tmp0.data()) - buf_tmp0.data());
+                }
+                catch (std::runtime_error const & e)
+                {
+                    error0 = e.what();
+                }
+                std::basic_string<och_type> buf_tmp1;
+                utf::conv<utf::utf8_dfa, Outf, utf::error_replace>(it, eit, std::back_inserter(buf_tmp1));
+                std::basic_string<och_type> buf_tmp2;
+                auto const status2 = utf::conv<utf::utf8_dfa, Outf, utf::error_stop>(it, eit, std::back_inserter(buf_tmp2));
+                auto success_contiguous =
+                    try_conv<utf::utf8_dfa, Outf>(it, eit) == expected &&
+                    error0 == expected.second &&
+                    (!error0.empty() || std::basic_string<och_type>(buf_tmp0.data(), size0) == expected.first) &&
+                    buf_tmp1 == replaced &&
+                    buf_tmp2 == stopped &&
+                    status2.in - it == status.in - buf.cbegin() &&
+                    status2.error == status.error &&
+                    utf::validate<utf::utf8_dfa>(it, eit) == utf::validate<utf::utf8>(it, eit);
+                if (expected.second.empty())
+                    success_contiguous = success_contiguous &&
+                        utf::size<utf::utf8_dfa>(it, eit) == utf::size<utf::utf8>(buf.cbegin(), buf.cend()) &&
+                        utf::converted_size<utf::utf8_dfa, Outf>(it, eit) == expected.first.size();
+                BOOST_TEST_REQUIRE(success_contiguous);
+            });
+    }
+}
+
+template<typename Utf>
+std::string encode_bytes(std::u32string const & u32)
+{
+    auto const units = encode<Utf>(u32);
+    std::string res(units.size() * sizeof(typename Utf::char_type), '\0');
+    if (!res.empty())
+        std::memcpy(&res[0], units.data(), res.size());
+    return res;
+}
+
+struct bytes_decoder final
+{
+    std::string const & buf;
+    size_t offset;
+
+    template<typename Utf>
+    std::string operator()(Utf) const
+    {
+        typedef typename Utf::char_type unit_type;
+        std::vector<unit_type> units((buf.size() - offset) / sizeof(unit_type));
+        if (!units.empty())
+            std::memcpy(units.data(), buf.data() + offset, units.size() * sizeof(unit_type));
+        std::string res;
+        utf::conv<Utf, utf::utf8>(units.data(), units.data() + units.size(), std::back_inserter(res));
+        return res;
+    }
+};
+
+template<typename Utf>
+void run_detect_encoding_test(std::u32string const & u32, utf::encoding const value, std::string const & bom)
+{
+    std::u32string text;
+    for (size_t n = 0; n < 8; ++n)
+        text += U"Hello, " + u32 + U" world\n";
+    auto const bytes = encode_bytes<Utf>(text);
+    std::string const u8(encode_bytes<utf::utf8>(text));
+
+    for_each_isa([&bytes, &bom, &u8, value]
+        {
+            auto const decode = [] (std::string const & buf, utf::detected_encoding const & detected)
+                {
+                    return utf::visit_encoding(detected.value, bytes_decoder{buf, detected.bom_size});
+                };
+            auto const marked = bom + bytes;
+            auto const detected0 = utf::detect_encoding(marked);
+            auto const detected1 = utf::detect_encoding(bytes);
+            // The prefix is cut in the middle of the symbols
+            auto const detected2 = utf::detect_encoding(bytes.data(), bytes.data() + bytes.size(), 61);
+            auto const success =
+                detected0.value == value && detected0.bom_size == bom.size() && detected0.confidence == 1.0 &&
+                detected1.value == value && detected1.bom_size == 0 && detected1.confidence > 0.0 &&
+                detected2.value == value &&
+                decode(marked, detected0) == u8 &&
+                decode(bytes, detected1) == u8;
+            BOOST_TEST_REQUIRE(success);
+        });
+}
+
+// Keeps only the code points encodable by the 8-bit codec
+template<typename Bytef>
+std::u32string narrow_text(std::u32string const & u32)
+{
+    std::u32string res;
+    for (auto const cp : u32)
+        if (cp <= Bytef::max_supported_code_point)
+            res.push_back(cp);
+    return res;
+}
+
+// The 8-bit codecs are converted in bulk and should produce exactly the same output in both directions
+template<
+    typename Bytef,
+    typename Utf>
+void run_byte_conv_test(std::u32string const & u32)
+{
+    auto const narrow = narrow_text<Bytef>(u32);
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 7)
+    {
+        std::u32string text;
+        for (size_t n = 0; n < 3; ++n)
+        {
+            text.append(pad_size + n, static_cast<char32_t>('a' + n));
+            if (n < 2)
+                text += narrow;
+        }
+        auto const bbuf = encode<Bytef>(text);
+        auto const ubuf = encode<Utf>(text);
+
+        for_each_isa([&bbuf, &ubuf, &text]
+            {
+                std::vector<typename Utf::char_type> buf_tmp0;
+                utf::conv<Bytef, Utf>(bbuf.data(), bbuf.data() + bbuf.size(), std::back_inserter(buf_tmp0));
+                std::vector<typename Bytef::char_type> buf_tmp1;
+                utf::conv<Utf, Bytef>(ubuf.data(), ubuf.data() + ubuf.size(), std::back_inserter(buf_tmp1));
+                auto const success =
+                    buf_tmp0 == ubuf &&
+                    buf_tmp1 == bbuf &&
+                    utf::size<Bytef>(bbuf.data(), bbuf.data() + bbuf.size()) == text.size() &&
+                    utf::validate<Bytef>(bbuf.data(), bbuf.data() + bbuf.size()) == bbuf.data() + bbuf.size();
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
+
+template<
+    typename Utf,
+    typename Outf>
+void run_byte_conv_random_test(uint32_t const max_cp)
+{
+    typedef typename Outf::char_type och_type;
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        auto const buf = random_text<Utf>(random, max_cp, 0);
+
+        std::vector<och_type> ebuf;
+        std::string error;
+        try
+        {
+            utf::conv<Utf, Outf>(buf.cbegin(), buf.cend(), std::back_inserter(ebuf));
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+        for_each_isa([&buf, &ebuf, &error]
+            {
+                std::vector<och_type> buf_tmp;
+                auto success = true;
+                try
+                {
+                    utf::conv<Utf, Outf>(buf.data(), buf.data() + buf.size(), std::back_inserter(buf_tmp));
+                    success = error.empty() && ebuf == buf_tmp;
+                }
+                catch (std::runtime_error const & e)
+                {
+                    success = error == e.what();
+                }
+                BOOST_TEST_REQUIRE(success);
+            });
+    }
+}
+
+template<typename Ch>
+void run_size_test(std::basic_string<Ch> const & buf)
+{
+    size_t total_chars = 0;
+    size_t total_cp = 0;
+    for (auto str = buf.data(); *str;)
+    {
+        auto const size = utf::char_size<utf::utf_selector_t<Ch>>(str);
+        BOOST_TEST_REQUIRE(!!size);
+        total_chars += size;
+        ++total_cp;
+        str += size;
+    }
+    BOOST_TEST_REQUIRE(buf.size() == total_chars);
+
+    auto const total_cp1 = utf::size<utf::utf_selector_t<Ch>>(buf.data());
+    BOOST_TEST_REQUIRE(total_cp == total_cp1);
+
+    auto const total_cp2 = utf::size<utf::utf_selector_t<Ch>>(buf.cbegin(), buf.cend());
+    BOOST_TEST_REQUIRE(total_cp == total_cp2);
+
+    for_each_isa([&buf, total_cp]
+        {
+            auto const success =
+                utf::size<utf::utf_selector_t<Ch>>(buf.data(), buf.data() + buf.size()) == total_cp &&
+                utf::size<utf::utf_selector_t<Ch>>(buf.c_str()) == total_cp;
+            BOOST_TEST_REQUIRE(success);
+        });
+
+    auto const total_cp3 = utf::size(buf.data());
+    BOOST_TEST_REQUIRE(total_cp == total_cp3);
+
+    auto const total_cp4 = utf::size(buf);
+    BOOST_TEST_REQUIRE(total_cp == total_cp4);
+
+#if __cpp_lib_string_view >= 201606
+    auto const total_cp5 = utf::size(std::basic_string_view<Ch>(buf.data(), buf.size()));
+    BOOST_TEST_REQUIRE(total_cp == total_cp5);
+#endif
+}
+
+// Counts the allocations made through the copies of the allocator
+template<typename T>
+struct counting_allocator
+{
+    using value_type = T;
+
+    size_t * count;
+
+    explicit counting_allocator(size_t * const count) throw() : count(count) {}
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const & other) throw() : count(other.count) {}
+
+    T * allocate(size_t const n)
+    {
+        ++*count;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T * const p, size_t const n) throw()
+    {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    struct rebind final { using other = counting_allocator<U>; };
+
+    template<typename U>
+    bool operator==(counting_allocator<U> const & other) const throw() { return count == other.count; }
+
+    template<typename U>
+    bool operator!=(counting_allocator<U> const & other) const throw() { return count != other.count; }
+};
+
+}
+
+BOOST_DATA_TEST_CASE(conv_u8_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_u8_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u16); }
+BOOST_DATA_TEST_CASE(conv_u8_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u8_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u8 , tuple.uw ); }
+BOOST_DATA_TEST_CASE(conv_u16_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_u16_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u16); }
+BOOST_DATA_TEST_CASE(conv_u16_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u16_to_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u16, tuple.uw ); }
+BOOST_DATA_TEST_CASE(conv_u32_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_u32_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u16); }
+BOOST_DATA_TEST_CASE(conv_u32_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u32_to_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.u32, tuple.uw ); }
+BOOST_DATA_TEST_CASE(conv_uw_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_uw_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u16); }
+BOOST_DATA_TEST_CASE(conv_uw_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_uw_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_test(tuple.uw , tuple.uw ); }
+
+BOOST_DATA_TEST_CASE(block_conv_u8_to_u8   , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u8 , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(block_conv_u8_to_u16  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u8 , tuple.u16); }
+BOOST_DATA_TEST_CASE(block_conv_u8_to_u32  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(block_conv_u8_to_uw   , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u8 , tuple.uw ); }
+BOOST_DATA_TEST_CASE(block_conv_u16_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u16, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(block_conv_u16_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u16, tuple.u16); }
+BOOST_DATA_TEST_CASE(block_conv_u16_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(block_conv_u16_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u16, tuple.uw ); }
+BOOST_DATA_TEST_CASE(block_conv_u32_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u32, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(block_conv_u32_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u32, tuple.u16); }
+BOOST_DATA_TEST_CASE(block_conv_u32_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u32, tuple.u32); }
+BOOST_DATA_TEST_CASE(block_conv_u32_to_uw  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.u32, tuple.uw ); }
+BOOST_DATA_TEST_CASE(block_conv_uw_to_u8   , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.uw , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(block_conv_uw_to_u16  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.uw , tuple.u16); }
+BOOST_DATA_TEST_CASE(block_conv_uw_to_u32  , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.uw , tuple.u32); }
+BOOST_DATA_TEST_CASE(block_conv_uw_to_uw   , boost::make_iterator_range(unicode_test_data), tuple) { run_block_conv_test(tuple.uw , tuple.uw ); }
+
+BOOST_AUTO_TEST_CASE(block_conv_u16_to_u8_random) { run_block_conv_random_test<char16_t, char>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(block_conv_u16_to_u32_random) { run_block_conv_random_test<char16_t, char32_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(block_conv_u32_to_u8_random) { run_block_conv_random_test<char32_t, char>(utf::utf32::max_supported_code_point + 1); }
+BOOST_AUTO_TEST_CASE(block_conv_u32_to_u16_random) { run_block_conv_random_test<char32_t, char16_t>(utf::max_unicode_code_point + 1); }
+
+BOOST_DATA_TEST_CASE(conv_into_u8_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u8 , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_into_u8_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u8 , tuple.u16); }
+BOOST_DATA_TEST_CASE(conv_into_u8_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_into_u16_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u16, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_into_u16_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_into_u32_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u32, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_into_u32_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_conv_into_test(tuple.u32, tuple.u16); }
+
+BOOST_DATA_TEST_CASE(conv_u32_to_u8_supported, boost::make_iterator_range(supported_test_data), tuple) { run_conv_test(tuple.u32, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(conv_u8_to_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_conv_test(tuple.u8 , tuple.u32); }
+
+BOOST_DATA_TEST_CASE(size_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(size_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u16); }
+BOOST_DATA_TEST_CASE(size_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.u32); }
+BOOST_DATA_TEST_CASE(size_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_size_test(tuple.uw ); }
+
+BOOST_DATA_TEST_CASE(size_u8_supported , boost::make_iterator_range(supported_test_data), tuple) { run_size_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(size_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_size_test(tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(size_u8_random ) { run_size_random_test<char    >(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(size_u16_random) { run_size_random_test<char16_t>(utf::max_unicode_code_point + 1); }
+
+BOOST_DATA_TEST_CASE(cp_index_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_cp_index_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(cp_index_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_cp_index_test(tuple.u16); }
+BOOST_DATA_TEST_CASE(cp_index_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_cp_index_test(tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(cp_index_u8_random ) { run_cp_index_random_test<char    >(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(cp_index_u16_random) { run_cp_index_random_test<char16_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(cp_index_u32_random) { run_cp_index_random_test<char32_t>(utf::utf32::max_supported_code_point + 1); }
+
+BOOST_DATA_TEST_CASE(offsets, boost::make_iterator_range(unicode_test_data), tuple) { run_offsets_test(tuple.u8); }
+
+BOOST_AUTO_TEST_CASE(offsets_random)
+{
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 256; ++n)
+        run_offsets_test(utf::conv<char>(random_text<utf::utf16, std::u16string>(random, utf::max_unicode_code_point + 1, 0, 1024)));
+}
+
+BOOST_AUTO_TEST_CASE(offsets_malformed)
+{
+    std::string const buf = std::string(100, 'a') + "\xC2\xC2\x80";
+    std::string error;
+    try
+    {
+        utf::converted_size<utf::utf8, utf::utf16>(buf.cbegin(), buf.cend());
+    }
+    catch (std::runtime_error const & e)
+    {
+        error = e.what();
+    }
+    for_each_isa([&buf, &error]
+        {
+            auto success = utf::utf16_to_utf8_offset(buf, 100) == 100;
+            try
+            {
+                utf::utf16_to_utf8_offset(buf, 101);
+                success = false;
+            }
+            catch (std::runtime_error const & e)
+            {
+                success = success && error == e.what();
+            }
+            BOOST_TEST_REQUIRE(success);
+        });
+}
+
+BOOST_DATA_TEST_CASE(codepoint_view_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_codepoint_view_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(codepoint_view_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_codepoint_view_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(codepoint_view_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_codepoint_view_test(tuple.u32, tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(codepoint_view_malformed)
+{
+    std::string const buf("\x41\xE2\x82");
+    auto const view = utf::make_codepoint_view(buf);
+    auto it = view.begin();
+    auto success = *it++ == 0x41;
+    try
+    {
+        *it;
+        success = false;
+    }
+    catch (std::runtime_error const & e)
+    {
+        success = success && std::string(e.what()) == "Not enough input";
+    }
+    BOOST_TEST_REQUIRE(success);
+}
+
+BOOST_DATA_TEST_CASE(read_back_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_read_back_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(read_back_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_read_back_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(read_back_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_read_back_test(tuple.u32, tuple.u32); }
+BOOST_DATA_TEST_CASE(read_back_u8_supported, boost::make_iterator_range(supported_test_data), tuple) { run_read_back_test(tuple.u8, tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(read_back_malformed)
+{
+    struct
+    {
+        std::string u8;
+        std::string error;
+    } const u8_data[] =
+    {
+        { "\x41\x80", "The utf8 first char in sequence is incorrect" },
+        { "\x41\xE2\x82", "The utf8 first char in sequence is incorrect" },
+        { "\xC2", "The utf8 first char in sequence is incorrect" },
+        { "\xFE", "The utf8 first char in sequence is incorrect" },
+        { "\x80\x80\x80\x80\x80\x80", "The utf8 slave char in sequence is incorrect" },
+        { "\x82\xAC", "Not enough input" },
+    };
+    for (auto const & data : u8_data)
+    {
+        std::u32string res;
+        BOOST_CHECK_EXCEPTION(utf::conv_back<utf::utf32>(data.u8, std::back_inserter(res)), std::runtime_error,
+            [&data] (std::runtime_error const & e) { return data.error == e.what(); });
+    }
+
+    struct
+    {
+        std::u16string u16;
+        std::string error;
+    } const u16_data[] =
+    {
+        { u"\xD800", "The low utf16 surrogate char is expected" },
+        { std::u16string(1, 0x41) + static_cast<char16_t>(0xDC00), "The high utf16 surrogate char is expected" },
+        { std::u16string(1, static_cast<char16_t>(0xDC00)), "Not enough input" },
+    };
+    for (auto const & data : u16_data)
+    {
+        std::u32string res;
+        BOOST_CHECK_EXCEPTION(utf::conv_back<utf::utf32>(data.u16, std::back_inserter(res)), std::runtime_error,
+            [&data] (std::runtime_error const & e) { return data.error == e.what(); });
+    }
+}
+
+BOOST_DATA_TEST_CASE(truncate_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_truncate_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(truncate_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_truncate_test(tuple.u16); }
+BOOST_DATA_TEST_CASE(truncate_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_truncate_test(tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(truncate_codepoints_long)
+{
+    std::string buf;
+    for (size_t n = 0; n < 4096; ++n)
+        buf += n % 3 ? "a" : n % 2 ? "\xE2\x82\xAC" : "\xF0\x9F\x98\x80";
+    for_each_isa([&buf]
+        {
+            auto success = true;
+            for (size_t const n : { 0, 1, 31, 32, 33, 100, 1000, 4095, 4096, 5000 })
+                success = success &&
+                    utf::truncate_codepoints<utf::utf8>(buf.data(), buf.data() + buf.size(), n) ==
+                    utf::truncate_codepoints<utf::utf8>(buf.cbegin(), buf.cend(), n) - buf.cbegin() + buf.data();
+            BOOST_TEST_REQUIRE(success);
+        });
+}
+
+BOOST_DATA_TEST_CASE(conv_swapped_u16_to_u8         , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u16, utf::utf8  >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u16_to_u16        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u16, utf::utf16 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u16_to_u32        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u16, utf::utf32 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u16_to_swapped_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u16, swapped_u32>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u32_to_u8         , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u32, utf::utf8  >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u32_to_u16        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u32, utf::utf16 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u32_to_u32        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u32, utf::utf32 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_swapped_u32_to_swapped_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<swapped_u32, swapped_u16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u8_to_swapped_u16         , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf8  , swapped_u16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u8_to_swapped_u32         , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf8  , swapped_u32>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u16_to_swapped_u16        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf16 , swapped_u16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u16_to_swapped_u32        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf16 , swapped_u32>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u32_to_swapped_u16        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf32 , swapped_u16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(conv_u32_to_swapped_u32        , boost::make_iterator_range(unicode_test_data), tuple) { run_swapped_conv_test<utf::utf32 , swapped_u32>(tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(conv_swapped_u16_to_u8_random ) { run_swapped_conv_random_test<swapped_u16, utf::utf8  >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(conv_swapped_u16_to_u16_random) { run_swapped_conv_random_test<swapped_u16, utf::utf16 >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(conv_swapped_u32_to_u8_random ) { run_swapped_conv_random_test<swapped_u32, utf::utf8  >(utf::utf32::max_supported_code_point + 1); }
+BOOST_AUTO_TEST_CASE(conv_u16_to_swapped_u16_random) { run_swapped_conv_random_test<utf::utf16 , swapped_u16>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(conv_u32_to_swapped_u16_random) { run_swapped_conv_random_test<utf::utf32 , swapped_u16>(utf::max_unicode_code_point + 1); }
+
+BOOST_AUTO_TEST_CASE(utf8_dfa_to_u16_random) { run_utf8_dfa_random_test<utf::utf16>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(utf8_dfa_to_u32_random) { run_utf8_dfa_random_test<utf::utf32>(utf::utf8::max_supported_code_point); }
+
+// The bulk codec interface should read, write and throw exactly like the per-unit one
+BOOST_AUTO_TEST_CASE(utf8_block_io)
+{
+    static_assert(utf::detail::has_read_block<utf::utf8>::value && utf::detail::has_write_block<utf::utf8>::value, "");
+    static_assert(!utf::detail::has_read_block<utf::utf16>::value && !utf::detail::has_write_block<utf::utf16>::value, "");
+
+    auto const check_cp = [] (uint32_t const cp)
+        {
+            std::string expected;
+            utf::utf8::write(cp, [&expected] (utf::utf8::char_type const ch) { expected.push_back(static_cast<char>(ch)); });
+            char buf[utf::utf8::max_supported_symbol_size * 2] = {};
+            char * oit = buf;
+            utf::utf8::write_block(cp, oit);
+            BOOST_REQUIRE_EQUAL(std::string(buf, oit), expected);
+            char const * it = buf;
+            BOOST_REQUIRE_EQUAL(utf::utf8::read_block(it), cp);
+            BOOST_REQUIRE(it == oit);
+        };
+    for (uint32_t cp = 0; cp <= utf::max_unicode_code_point; ++cp)
+        check_cp(cp);
+    for (uint32_t const cp : {0x1FFFFFu, 0x200000u, 0x3FFFFFFu, 0x4000000u, utf::utf8::max_supported_code_point})
+        check_cp(cp);
+
+    boost::random::mt19937 random(0);
+    for (size_t n = 0; n < 0x100000; ++n)
+    {
+        // The lead char followed by the mostly correct slave chars
+        char buf[utf::utf8::max_supported_symbol_size];
+        buf[0] = static_cast<char>(0x80 + random() % 0x80);
+        for (size_t i = 1; i < sizeof(buf); ++i)
+            buf[i] = static_cast<char>(random() % 8 ? 0x80 + random() % 0x40 : random());
+        std::string expected;
+        uint32_t expected_cp = 0;
+        char const * expected_it = buf;
+        try
+        {
+            expected_cp = utf::utf8::read([&expected_it] { return *expected_it++; });
+        }
+        catch (std::runtime_error const & e)
+        {
+            expected = e.what();
+        }
+        std::string error;
+        uint32_t cp = 0;
+        char const * it = buf;
+        try
+        {
+            cp = utf::utf8::read_block(it);
+        }
+        catch (std::runtime_error const & e)
+        {
+            error = e.what();
+        }
+        BOOST_REQUIRE_EQUAL(error, expected);
+        if (error.empty())
+        {
+            BOOST_REQUIRE_EQUAL(cp, expected_cp);
+            BOOST_REQUIRE(it == expected_it);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(endian_codecs)
+{
+    unsigned char const be[] = { 0x00, 0x41, 0xD8, 0x3D, 0xDE, 0x00, 0x20, 0xAC };
+    unsigned char const le[] = { 0x41, 0x00, 0x3D, 0xD8, 0x00, 0xDE, 0xAC, 0x20 };
+    std::vector<uint16_t> u16be(4);
+    std::memcpy(u16be.data(), be, sizeof(be));
+    std::vector<uint16_t> u16le(4);
+    std::memcpy(u16le.data(), le, sizeof(le));
+    std::string const u8("\x41\xF0\x9F\x98\x80\xE2\x82\xAC");
+    unsigned char be_odd[1 + sizeof(be)] = {};
+    std::memcpy(be_odd + 1, be, sizeof(be));
+    utf::byte_unit_iterator<uint16_t> const be_first(be_odd + 1);
+
+    std::string res_be;
+    utf::conv<utf::utf16be, utf::utf8>(u16be.data(), u16be.data() + u16be.size(), std::back_inserter(res_be));
+    std::string res_be_odd;
+    utf::conv<utf::utf16be, utf::utf8>(be_first, be_first + 4, std::back_inserter(res_be_odd));
+    std::string res_le;
+    utf::conv<utf::utf16le, utf::utf8>(u16le.data(), u16le.data() + u16le.size(), std::back_inserter(res_le));
+    std::vector<uint32_t> u32be;
+    utf::conv<utf::utf8, utf::utf32be>(u8.cbegin(), u8.cend(), std::back_inserter(u32be));
+    unsigned char const u32be_bytes[] = { 0x00, 0x00, 0x00, 0x41, 0x00, 0x01, 0xF6, 0x00, 0x00, 0x00, 0x20, 0xAC };
+    auto success =
+        res_be == u8 &&
+        res_be_odd == u8 &&
+        res_le == u8 &&
+        u32be.size() == 3 &&
+        !std::memcmp(u32be.data(), u32be_bytes, sizeof(u32be_bytes)) &&
+        utf::size<utf::utf16be>(u16be.cbegin(), u16be.cend()) == 3 &&
+        utf::converted_size<utf::utf16be, utf::utf8>(u16be.cbegin(), u16be.cend()) == u8.size() &&
+        utf::validate<utf::utf16be>(u16be.data(), u16be.data() + 2) == u16be.data() + 1 &&
+        utf::conv<utf::utf16be, utf::utf8, utf::error_stop>(u16be.data(), u16be.data() + 2, std::back_inserter(res_be)).error == utf::utf_error::not_enough_input;
+    BOOST_TEST_REQUIRE(success);
+
+    std::string res;
+    BOOST_CHECK_EXCEPTION((utf::conv<utf::utf16be, utf::utf8>(u16be.data() + 2, u16be.data() + 3, std::back_inserter(res))), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "The high utf16 surrogate char is expected"; });
+}
+
+BOOST_DATA_TEST_CASE(byte_conv_latin1_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::latin1, utf::utf8 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(byte_conv_latin1_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::latin1, utf::utf16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(byte_conv_latin1_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::latin1, utf::utf32>(tuple.u32); }
+BOOST_DATA_TEST_CASE(byte_conv_ascii_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::ascii , utf::utf8 >(tuple.u32); }
+BOOST_DATA_TEST_CASE(byte_conv_ascii_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::ascii , utf::utf16>(tuple.u32); }
+BOOST_DATA_TEST_CASE(byte_conv_ascii_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_byte_conv_test<utf::ascii , utf::utf32>(tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(byte_conv_latin1_to_u8_random) { run_byte_conv_random_test<utf::latin1, utf::utf8  >(0x100); }
+BOOST_AUTO_TEST_CASE(byte_conv_u8_to_latin1_random) { run_byte_conv_random_test<utf::utf8  , utf::latin1>(0x100); }
+BOOST_AUTO_TEST_CASE(byte_conv_u8_to_latin1_wide_random) { run_byte_conv_random_test<utf::utf8  , utf::latin1>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(byte_conv_u8_to_ascii_random ) { run_byte_conv_random_test<utf::utf8  , utf::ascii >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(byte_conv_latin1_to_ascii_random) { run_byte_conv_random_test<utf::latin1, utf::ascii>(0x100); }
+BOOST_AUTO_TEST_CASE(byte_conv_ascii_to_u16_random) { run_byte_conv_random_test<utf::ascii , utf::utf16 >(0x80); }
+
+BOOST_AUTO_TEST_CASE(byte_codecs)
+{
+    std::string const u8("caf\xC3\xA9 \xE2\x82\xAC");
+    std::string latin1;
+    utf::conv<utf::utf8, utf::latin1, utf::error_replace>(u8.data(), u8.data() + u8.size(), std::back_inserter(latin1));
+    std::string ascii;
+    utf::conv<utf::utf8, utf::ascii, utf::error_replace>(u8.data(), u8.data() + u8.size(), std::back_inserter(ascii));
+    std::string const latin1_z("caf\xE9");
+    std::u16string u16;
+    utf::convz<utf::latin1, utf::utf16>(latin1_z.c_str(), std::back_inserter(u16));
+    std::string bad_ascii("ab\x80");
+    auto const success =
+        latin1 == "caf\xE9 ?" &&
+        ascii == "caf? ?" &&
+        u16 == u"café" &&
+        utf::size<utf::latin1>(latin1_z.c_str()) == 4 &&
+        utf::validate<utf::ascii>(bad_ascii.data(), bad_ascii.data() + bad_ascii.size()) == bad_ascii.data() + 2;
+    BOOST_TEST_REQUIRE(success);
+
+    std::string res;
+    BOOST_CHECK_EXCEPTION((utf::conv<utf::utf8, utf::latin1>(u8.data(), u8.data() + u8.size(), std::back_inserter(res))), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "Too large latin1 code point"; });
+    BOOST_CHECK_EXCEPTION((utf::conv<utf::ascii, utf::utf8>(bad_ascii.data(), bad_ascii.data() + bad_ascii.size(), std::back_inserter(res))), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "Too large ascii char"; });
+}
+
+#if defined(WW898_UTF_HAS_CONSTEXPR14)
+// The literals are transcoded at compile time
+constexpr auto constexpr_u16 = utf::literal<char16_t>(u8"Привет, мир \U0001F600");
+static_assert(constexpr_u16.size() == 14 && constexpr_u16[0] == 0x41F && constexpr_u16[12] == 0xD83D && constexpr_u16[13] == 0xDE00, "");
+constexpr auto constexpr_u8 = utf::literal<char>(U"aé\U0001F600");
+static_assert(constexpr_u8.size() == 7 && constexpr_u8[1] == '\xC3' && constexpr_u8[7] == '\0', "");
+constexpr auto constexpr_u32 = utf::literal<char32_t>(u"x\xD83D\xDE00");
+static_assert(constexpr_u32.size() == 2 && constexpr_u32[1] == 0x1F600, "");
+#endif
+
+BOOST_AUTO_TEST_CASE(literal)
+{
+    auto const u16 = utf::literal<char16_t>(u8"Привет, мир \U0001F600");
+    auto const u8 = utf::literal<char>(U"aé\U0001F600");
+    auto const u32 = utf::literal<char32_t>(u"x\xD83D\xDE00");
+    auto const uw = utf::literal<wchar_t>("");
+    auto const success =
+        u16.str() == utf::conv<char16_t>(std::u32string(U"Привет, мир \U0001F600")) &&
+        u16.c_str()[u16.size()] == 0 &&
+        u8.str() == "a\xC3\xA9\xF0\x9F\x98\x80" &&
+        u32.str() == U"x\U0001F600" &&
+        uw.empty() && uw.c_str()[0] == 0;
+    BOOST_TEST_REQUIRE(success);
+
+    BOOST_CHECK_EXCEPTION(utf::literal<char16_t>("\xFF"), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "The utf8 first char in sequence is incorrect"; });
+    BOOST_CHECK_EXCEPTION(utf::literal<char16_t>("\xC3"), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "Not enough input"; });
+    BOOST_CHECK_EXCEPTION(utf::literal<char16_t>(U"\U0010FFFF\x110000"), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "Too large the utf16 code point"; });
+}
+
+BOOST_AUTO_TEST_CASE(conv_allocator)
+{
+    size_t count = 0;
+    counting_allocator<char16_t> const alloc(&count);
+    std::string const u8("\x41\xD0\x96\xF0\x9F\x98\x80 long enough to be allocated on the heap");
+    auto const u16 = utf::conv<char16_t>(u8, alloc);
+    auto const u16z = utf::convz<char16_t>(u8.c_str(), alloc);
+    auto const u8_back = utf::conv<char>(u16, counting_allocator<char>(&count));
+    auto const success =
+        u16 == utf::conv<char16_t>(u8).c_str() &&
+        u16z == u16 &&
+        u8_back == u8.c_str() &&
+        count >= 3 && count <= 4; // The unused room of `u8_back` may be given back
+    BOOST_TEST_REQUIRE(success);
+
+    std::u32string u32(U"x");
+    utf::conv_append(std::string("\xD0\x96"), u32);
+    utf::conv_append(std::u16string(u"\U0001F600"), u32);
+    std::vector<char> vec;
+    utf::conv_append(u32, vec);
+    auto const status = utf::conv_append<utf::error_stop>(std::string("\x41\xC2"), u32);
+    auto const appended =
+        u32 == U"x\u0416\U0001F600A" &&
+        std::string(vec.begin(), vec.end()) == "x\xD0\x96\xF0\x9F\x98\x80" &&
+        status.error == utf::utf_error::not_enough_input;
+    BOOST_TEST_REQUIRE(appended);
+    BOOST_CHECK_THROW(utf::conv_append(std::string("\x41\xC2"), u32), std::runtime_error);
+    BOOST_TEST_REQUIRE((u32 == U"x\u0416\U0001F600A"));
+
+#if defined(__cpp_lib_memory_resource)
+    char arena[1024];
+    std::pmr::monotonic_buffer_resource resource(arena, sizeof(arena), std::pmr::null_memory_resource());
+    std::pmr::u16string const pmr_u16 = utf::conv<char16_t>(u8, std::pmr::polymorphic_allocator<char16_t>(&resource));
+    std::pmr::vector<char32_t> pmr_u32(&resource);
+    utf::conv_append(pmr_u16, pmr_u32);
+    auto const pmr_success =
+        pmr_u16 == u16.c_str() &&
+        pmr_u32.size() == utf::size(u8);
+    BOOST_TEST_REQUIRE(pmr_success);
+#endif
+}
+
+// The output grows to the worst case size at once
+BOOST_AUTO_TEST_CASE(conv_worst_case)
+{
+    std::string const malformed(100, '\xFF');
+    std::u32string const wide(100, 0x7FFFFFFF);
+    std::u16string const bmp(100, 0xFFFD);
+    std::string replaced;
+    for (size_t n = 0; n < 100; ++n)
+        replaced += "\xEF\xBF\xBD";
+    std::string app("x");
+    utf::conv_append<utf::error_replace>(malformed, app);
+    auto const success =
+        utf::conv<char, utf::error_replace>(malformed) == replaced &&
+        utf::convz<char, utf::error_replace>(malformed.c_str()) == replaced &&
+        app == "x" + replaced &&
+        utf::conv<char>(wide).size() == 600 &&
+        utf::conv<char>(bmp) == replaced &&
+        utf::conv<char16_t>(std::string()).empty() &&
+        utf::convz<char16_t>("").empty();
+    BOOST_TEST_REQUIRE(success);
+}
+
+// The result does not keep the worst case room
+BOOST_AUTO_TEST_CASE(conv_capacity)
+{
+    std::u16string const ascii(1000000, u'a');
+    auto const u8 = utf::conv<char>(ascii);
+    auto const u8z = utf::convz<char>(ascii.c_str());
+    std::string const malformed(1000, '\xFF');
+    auto const replaced = utf::conv<char16_t, utf::error_replace>(malformed + std::string(1000000, 'a'));
+    std::string app("x");
+    app.reserve(16);
+    utf::conv_append(ascii, app);
+    std::vector<char32_t> vec(1, U'x');
+    utf::conv_append(std::string(1000000, 'a'), vec);
+    auto const success =
+        u8.size() == 1000000 && u8.capacity() - u8.size() <= u8.size() / 4 &&
+        u8z.size() == 1000000 && u8z.capacity() - u8z.size() <= u8z.size() / 4 &&
+        replaced.size() == 1001000 && replaced.capacity() - replaced.size() <= replaced.size() / 4 &&
+        app.size() == 1000001 && app.capacity() - app.size() <= app.size() / 4 &&
+        vec.size() == 1000001 && vec.capacity() - vec.size() <= vec.size() / 4;
+    BOOST_TEST_REQUIRE(success);
+}
+
+BOOST_DATA_TEST_CASE(detect_encoding_u8   , boost::make_iterator_range(unicode_test_data), tuple) { run_detect_encoding_test<utf::utf8   >(tuple.u32, utf::encoding::utf8   , "\xEF\xBB\xBF"    ); }
+BOOST_DATA_TEST_CASE(detect_encoding_u16le, boost::make_iterator_range(unicode_test_data), tuple) { run_detect_encoding_test<utf::utf16le>(tuple.u32, utf::encoding::utf16le, "\xFF\xFE"        ); }
+BOOST_DATA_TEST_CASE(detect_encoding_u16be, boost::make_iterator_range(unicode_test_data), tuple) { run_detect_encoding_test<utf::utf16be>(tuple.u32, utf::encoding::utf16be, "\xFE\xFF"        ); }
+BOOST_DATA_TEST_CASE(detect_encoding_u32le, boost::make_iterator_range(unicode_test_data), tuple) { run_detect_encoding_test<utf::utf32le>(tuple.u32, utf::encoding::utf32le, std::string("\xFF\xFE\0\0", 4)); }
+BOOST_DATA_TEST_CASE(detect_encoding_u32be, boost::make_iterator_range(unicode_test_data), tuple) { run_detect_encoding_test<utf::utf32be>(tuple.u32, utf::encoding::utf32be, std::string("\0\0\xFE\xFF", 4)); }
+
+BOOST_AUTO_TEST_CASE(detect_encoding_weak)
+{
+    // No ASCII chars, so only the validity is left
+    auto const cjk = encode_bytes<utf::utf16be>(U"中文文本");
+    auto const cjk_detected = utf::detect_encoding(cjk);
+    auto const latin1_detected = utf::detect_encoding(std::string("caf\xE9"));
+    auto const garbage_detected = utf::detect_encoding(std::string("\xFF\xFF\xFF"));
+    auto const empty_detected = utf::detect_encoding(std::string());
+    // The zero bytes after the last whole UTF-32 unit
+    auto const u16_tail_detected = utf::detect_encoding(std::string("A\0", 2));
+    auto const zero_tail_detected = utf::detect_encoding(std::string("hello\0", 6));
+    auto const success =
+        u16_tail_detected.confidence < 1.0 &&
+        zero_tail_detected.confidence < 1.0 &&
+        cjk_detected.confidence > 0.0 && cjk_detected.confidence <= 0.5 &&
+        latin1_detected.value == utf::encoding::utf16le && latin1_detected.confidence <= 0.5 &&
+        garbage_detected.value == utf::encoding::unknown && garbage_detected.confidence == 0.0 &&
+        empty_detected.value == utf::encoding::utf8;
+    BOOST_TEST_REQUIRE(success);
+    std::string const buf;
+    BOOST_CHECK_EXCEPTION(utf::visit_encoding(utf::encoding::unknown, bytes_decoder{buf, 0}), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "Unknown encoding"; });
+}
+
+BOOST_DATA_TEST_CASE(converted_size_u8_to_u8  , boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u8 , tuple.u8 ); }
+BOOST_DATA_TEST_CASE(converted_size_u8_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u8 , tuple.u16); }
+BOOST_DATA_TEST_CASE(converted_size_u8_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(converted_size_u16_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u16, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(converted_size_u16_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(converted_size_u32_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u32, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(converted_size_u32_to_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_converted_size_test(tuple.u32, tuple.u16); }
+
+// The overlong 4-byte form of the BMP symbol takes one UTF-16 unit, the padding runs it through the bulk counting
+BOOST_AUTO_TEST_CASE(converted_size_u8_overlong)
+{
+    std::string const u8("\xF0\x87\xAD\xBA\xF0\x80\x80\xB0\xF0\x9F\x98\x80");
+    std::u16string const u16(u"\u7B7A\x30\U0001F600");
+    std::u32string const u32(U"\u7B7A\x30\U0001F600");
+    for (size_t pad_size = 0; pad_size < 80; pad_size += 7)
+    {
+        std::string const pad(pad_size, 'a');
+        run_converted_size_test(pad + u8 + pad, std::u16string(pad_size, u'a') + u16 + std::u16string(pad_size, u'a'));
+        run_converted_size_test(pad + u8 + pad, std::u32string(pad_size, U'a') + u32 + std::u32string(pad_size, U'a'));
+    }
+}
+
+BOOST_DATA_TEST_CASE(converted_size_u8_to_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_converted_size_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(converted_size_u32_to_u8_supported, boost::make_iterator_range(supported_test_data), tuple) { run_converted_size_test(tuple.u32, tuple.u8 ); }
+
+BOOST_AUTO_TEST_CASE(converted_size_u8_to_u16_random ) { run_converted_size_random_test<char    , char16_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(converted_size_u8_to_u32_random ) { run_converted_size_random_test<char    , char32_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(converted_size_u16_to_u8_random ) { run_converted_size_random_test<char16_t, char    >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(converted_size_u32_to_u16_random) { run_converted_size_random_test<char32_t, char16_t>(utf::utf32::max_supported_code_point + 1); }
+
+BOOST_AUTO_TEST_CASE(error_policy_u8_to_u32)
+{
+    run_error_policy_test(std::string("\x41\xC2\x41\xE2\x82"), std::u32string(U"A\uFFFDA\uFFFD"), std::u32string(U"AA"), 1, utf::utf_error::invalid_slave);
+    run_error_policy_test(std::string("\xBF\x41"), std::u32string(U"\uFFFDA"), std::u32string(U"A"), 0, utf::utf_error::invalid_lead);
+    run_error_policy_test(std::string("\x41\xF0\x90\x8D"), std::u32string(U"A\uFFFD"), std::u32string(U"A"), 1, utf::utf_error::not_enough_input);
+    run_error_policy_test(std::string("\xFE\xE2\x82\xAC"), std::u32string(U"\uFFFD\u20AC"), std::u32string(U"\u20AC"), 0, utf::utf_error::invalid_lead);
+}
+
+BOOST_AUTO_TEST_CASE(error_policy_u8_to_u16)
+{
+    run_error_policy_test(std::string("\x41\xFD\xBF\xBF\xBF\xBF\xBF\x41"), std::u16string(u"A\uFFFDA"), std::u16string(u"AA"), 1, utf::utf_error::invalid_code_point);
+    run_error_policy_test(std::string("\xED\xA0\x80\xF0\x9F\x98\x80"), std::u16string(u"\uFFFD\U0001F600"), std::u16string(u"\U0001F600"), 0, utf::utf_error::invalid_code_point);
+}
+
+BOOST_AUTO_TEST_CASE(error_policy_u16_to_u8)
+{
+    run_error_policy_test(std::u16string({ 0xDC00, 0x0024, 0xD800 }), std::string("\xEF\xBF\xBD$\xEF\xBF\xBD"), std::string("$"), 0, utf::utf_error::invalid_lead);
+    run_error_policy_test(std::u16string({ 0x0024, 0xD852, 0xD852, 0xDF62 }), std::string("$\xEF\xBF\xBD\xF0\xA4\xAD\xA2"), std::string("$\xF0\xA4\xAD\xA2"), 1, utf::utf_error::invalid_slave);
+}
+
+BOOST_AUTO_TEST_CASE(error_policy_u32_to_u16)
+{
+    run_error_policy_test(std::u32string({ 0x24, 0xD800, 0x110000, 0x80000000, 0x24 }), std::u16string(u"$\uFFFD\uFFFD\uFFFD$"), std::u16string(u"$$"), 1, utf::utf_error::invalid_code_point);
+}
+
+BOOST_AUTO_TEST_CASE(error_policy_u8_to_u16_random ) { run_error_policy_random_test<char    , char16_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(error_policy_u8_to_u32_random ) { run_error_policy_random_test<char    , char32_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(error_policy_u16_to_u8_random ) { run_error_policy_random_test<char16_t, char    >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(error_policy_u16_to_u32_random) { run_error_policy_random_test<char16_t, char32_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(error_policy_u32_to_u8_random ) { run_error_policy_random_test<char32_t, char    >(utf::utf32::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(error_policy_u32_to_u16_random) { run_error_policy_random_test<char32_t, char16_t>(utf::utf32::max_supported_code_point); }
+
+BOOST_DATA_TEST_CASE(transcoder_u8_to_u16 , boost::make_iterator_range(unicode_test_data), tuple) { run_transcoder_test(tuple.u8 , tuple.u16); }
+BOOST_DATA_TEST_CASE(transcoder_u8_to_u32 , boost::make_iterator_range(unicode_test_data), tuple) { run_transcoder_test(tuple.u8 , tuple.u32); }
+BOOST_DATA_TEST_CASE(transcoder_u16_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_transcoder_test(tuple.u16, tuple.u8 ); }
+BOOST_DATA_TEST_CASE(transcoder_u16_to_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_transcoder_test(tuple.u16, tuple.u32); }
+BOOST_DATA_TEST_CASE(transcoder_u32_to_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_transcoder_test(tuple.u32, tuple.u8 ); }
+
+BOOST_DATA_TEST_CASE(transcoder_u8_to_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_transcoder_test(tuple.u8 , tuple.u32); }
+
+BOOST_AUTO_TEST_CASE(transcoder_u8_to_u16_random ) { run_transcoder_random_test<char    , char16_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(transcoder_u8_to_u32_random ) { run_transcoder_random_test<char    , char32_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(transcoder_u16_to_u8_random ) { run_transcoder_random_test<char16_t, char    >(utf::max_unicode_code_point + 1); }
+
+BOOST_AUTO_TEST_CASE(transcoder_finish)
+{
+    utf::basic_transcoder<utf::utf8, utf::utf16> transcoder;
+    std::u16string buf;
+    transcoder.feed(std::string("\x41\xF0\x9F"), std::back_inserter(buf));
+    auto const success =
+        transcoder.pending() == 2 &&
+        buf == u"A";
+    BOOST_TEST_REQUIRE(success);
+    BOOST_CHECK_THROW(transcoder.finish(), std::runtime_error);
+    BOOST_TEST_REQUIRE(transcoder.pending() == 0);
+
+    // The lead which breaks the previous symbol is the error of that symbol, in one chunk or across the chunks
+    struct
+    {
+        std::vector<std::string> chunks;
+        std::string error;
+    } const u8_data[] =
+    {
+        { { "a\xF0\x90\xC0" }, "The utf8 slave char in sequence is incorrect" },
+        { { "a\xF0\x90", "\xC0" }, "The utf8 slave char in sequence is incorrect" },
+        { { "a\xF0", "\x90\xC0" }, "The utf8 slave char in sequence is incorrect" },
+        { { "a\xE2\x82", "\xF0\x9F" }, "The utf8 slave char in sequence is incorrect" },
+    };
+    for (auto const & data : u8_data)
+    {
+        utf::basic_transcoder<utf::utf8, utf::utf16> u8_transcoder;
+        std::u16string res;
+        BOOST_CHECK_EXCEPTION(
+            {
+                for (auto const & chunk : data.chunks)
+                    u8_transcoder.feed(chunk, std::back_inserter(res));
+                u8_transcoder.finish();
+            },
+            std::runtime_error,
+            [&data] (std::runtime_error const & e) { return data.error == e.what(); });
+    }
+
+    std::u16string const u16_chunk{static_cast<char16_t>(0xD800), static_cast<char16_t>(0xD800)};
+    utf::basic_transcoder<utf::utf16, utf::utf8> u16_transcoder;
+    std::string res;
+    BOOST_CHECK_EXCEPTION(u16_transcoder.feed(u16_chunk, std::back_inserter(res)), std::runtime_error,
+        [] (std::runtime_error const & e) { return std::string(e.what()) == "The low utf16 surrogate char is expected"; });
+}
+
+BOOST_AUTO_TEST_CASE(parallel_conv_u8_to_u16_random ) { run_parallel_conv_random_test<char    , char16_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(parallel_conv_u8_to_u32_random ) { run_parallel_conv_random_test<char    , char32_t>(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(parallel_conv_u16_to_u8_random ) { run_parallel_conv_random_test<char16_t, char    >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(parallel_conv_u32_to_u16_random) { run_parallel_conv_random_test<char32_t, char16_t>(utf::utf32::max_supported_code_point); }
+
+BOOST_AUTO_TEST_CASE(parallel_conv_executor)
+{
+    std::vector<size_t> tasks;
+    auto const executor = [&tasks] (size_t const task_count, std::function<void (size_t)> const & fn)
+        {
+            for (size_t n = task_count; n-- > 0; )
+            {
+                tasks.push_back(n);
+                fn(n);
+            }
+        };
+    auto const res = utf::parallel_conv<char16_t>(std::string("\xF0\x9F\x98\x80\x41\xE2\x82\xAC"), executor, 2);
+    auto const success =
+        res == u"\U0001F600A\u20AC" &&
+        tasks.size() == 6;
+    BOOST_TEST_REQUIRE(success);
+}
+
+// Every task runs once when the pool is reused, busy with the other caller or called from the task itself
+BOOST_AUTO_TEST_CASE(thread_executor_pool)
+{
+    for (auto const & executor : { utf::thread_executor(), utf::thread_executor(4), utf::thread_executor(1) })
+    {
+        std::vector<std::atomic<size_t>> counts(64);
+        auto const fn = [&executor, &counts] (size_t const n)
+            {
+                ++counts[n];
+                if (n % 16 == 0)
+                    executor(4, [&counts, n] (size_t const m) { ++counts[n + m + 1]; });
+            };
+        std::vector<std::thread> callers;
+        for (size_t n = 0; n < 4; ++n)
+            callers.emplace_back([&executor, &fn] { for (size_t m = 0; m < 64; ++m) executor(64, fn); });
+        for (auto & caller : callers)
+            caller.join();
+        auto success = true;
+        for (size_t n = 0; n < counts.size(); ++n)
+            success = success && counts[n] == (n % 16 == 0 || n % 16 > 4 ? 256 : 512);
+        BOOST_TEST_REQUIRE(success);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_conv_u8_to_u16_random ) { run_batch_conv_random_test<char    , char16_t>(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(batch_conv_u16_to_u8_random ) { run_batch_conv_random_test<char16_t, char    >(utf::max_unicode_code_point + 1); }
+BOOST_AUTO_TEST_CASE(batch_conv_u32_to_u8_random ) { run_batch_conv_random_test<char32_t, char    >(utf::utf32::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(batch_conv_u16_to_u16_random) { run_batch_conv_random_test<char16_t, char16_t>(utf::max_unicode_code_point + 1); }
+
+BOOST_AUTO_TEST_CASE(batch_conv_offsets)
+{
+    static char16_t const data[] = u"abc\u0416\U0001F600";
+    uint8_t const offsets[] = { 0, 1, 1, 3, 6 };
+    std::string res_data;
+    std::vector<uint8_t> res_offsets;
+    utf::batch_conv<utf::utf16, utf::utf8>(data, offsets, 4, res_data, res_offsets);
+    auto const success =
+        res_data == "abc\xD0\x96\xF0\x9F\x98\x80" &&
+        res_offsets == std::vector<uint8_t>({ 0, 1, 1, 3, 9 });
+    BOOST_TEST_REQUIRE(success);
+
+    std::u32string const long_value(100, 0x20AC);
+    BOOST_CHECK_EXCEPTION(utf::batch_conv(&long_value, &long_value + 1, res_data, res_offsets), std::length_error,
+        [] (std::length_error const & e) { return std::string(e.what()) == "Too large output for the offset type"; });
+    BOOST_TEST_REQUIRE((res_data.empty() && res_offsets.empty()));
+
+    std::vector<std::string> const empty;
+    utf::batch_conv(empty.cbegin(), empty.cend(), res_data, res_offsets);
+    BOOST_TEST_REQUIRE((res_data.empty() && res_offsets == std::vector<uint8_t>(1, 0)));
+}
+
+BOOST_DATA_TEST_CASE(validate_u8 , boost::make_iterator_range(unicode_test_data), tuple) { run_validate_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(validate_u16, boost::make_iterator_range(unicode_test_data), tuple) { run_validate_test(tuple.u16); }
+BOOST_DATA_TEST_CASE(validate_u32, boost::make_iterator_range(unicode_test_data), tuple) { run_validate_test(tuple.u32); }
+BOOST_DATA_TEST_CASE(validate_uw , boost::make_iterator_range(unicode_test_data), tuple) { run_validate_test(tuple.uw ); }
+
+BOOST_DATA_TEST_CASE(validate_u8_supported , boost::make_iterator_range(supported_test_data), tuple) { run_validate_test(tuple.u8 ); }
+BOOST_DATA_TEST_CASE(validate_u32_supported, boost::make_iterator_range(supported_test_data), tuple) { run_validate_test(tuple.u32); }
+
+BOOST_DATA_TEST_CASE(validate_u8_malformed , boost::make_iterator_range(malformed_u8_test_data ), tuple) { run_validate_error_test(tuple); }
+BOOST_DATA_TEST_CASE(validate_u16_malformed, boost::make_iterator_range(malformed_u16_test_data), tuple) { run_validate_error_test(tuple); }
+BOOST_DATA_TEST_CASE(validate_u32_malformed, boost::make_iterator_range(malformed_u32_test_data), tuple) { run_validate_error_test(tuple); }
+
+BOOST_AUTO_TEST_CASE(set_active_isa)
+{
+    auto const supported = utf::supported_isa();
+    auto const success =
+        utf::set_active_isa(utf::isa::scalar) == utf::isa::scalar &&
+        utf::active_isa() == utf::isa::scalar &&
+        utf::set_active_isa(utf::isa::avx512) == supported &&
+        utf::active_isa() == supported;
+    BOOST_TEST_REQUIRE(success);
+}
+
+BOOST_AUTO_TEST_CASE(validate_u8_random ) { run_validate_random_test<char    >(utf::utf8::max_supported_code_point); }
+BOOST_AUTO_TEST_CASE(validate_u16_random) { run_validate_random_test<char16_t>(utf::max_unicode_code_point + 1); }
+
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<char>, utf::utf_selector_t<unsigned char>>::value);
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<char>, utf::utf_selector_t<signed   char>>::value);
+
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<signed char>, utf::utf_selector_t<         char>>::value);
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<signed char>, utf::utf_selector_t<unsigned char>>::value);
+
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<unsigned char>, utf::utf_selector_t<       char>>::value);
+BOOST_STATIC_ASSERT(std::is_same<utf::utf_selector_t<unsigned char>, utf::utf_selector_t<signed char>>::value);
+
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<         char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<signed   char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<unsigned char>>::value);
+
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<         char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<signed   char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char32_t>, utf::utf_selector_t<unsigned char>>::value);
+
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<char16_t>, utf::utf_selector_t<char32_t>>::value);
+
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<         char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<signed   char>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<unsigned char>>::value);
+
+#if defined(_WIN32)
+
+BOOST_STATIC_ASSERT( std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char16_t>>::value);
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char32_t>>::value);
+
+#elif defined(__linux__) || defined(__APPLE__)
+
+BOOST_STATIC_ASSERT(!std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char16_t>>::value);
+BOOST_STATIC_ASSERT( std::is_same<utf::utf_selector_t<wchar_t>, utf::utf_selector_t<char32_t>>::value);
+
+#else
+#error Unknown platform
+#endif
+
+namespace {
+
+uint64_t get_time() throw()
+{
+#if defined(_MSC_VER)
+
+#if defined(_M_IX86) || defined(_M_X64)
+    // Note: CPUID can be executed at any privilege level to serialize instruction execution. Serializing instruction
+    //       execution guarantees that any modifications to flags, registers, and memory for previous instructions are
+    //       completed before the next instruction is fetched and executed.
+    int cpu_info[4];
+    __cpuid(cpu_info, 0);
+    return __rdtsc();
+#elif defined(_M_ARM64)
+    return _ReadStatusReg(ARM64_CNTVCT);
+#else
+#error Unsupported architecture
+#endif
+
+#elif defined(__GNUC__) // Clang also defines __GNUC__ for compatibility with GCC.
+
+#if defined(__i386__) || defined(__x86_64__)
+    uint32_t lo, hi;
+    asm volatile(
+        "cpuid\n\t"
+        "rdtsc\n\t"
+        : "=a"(lo), "=d"(hi) : "a"(0) :
+#if defined(__i386__)
+        "%ebx", "%ecx"
+#else
+        "%rbx", "%rcx"
+#endif
+        );
+    return static_cast<uint64_t>(hi) << 32 | lo;
+#elif defined(__aarch64__)
+    uint64_t cntvct_el0;
+    asm volatile(
+        "mrs %0, cntvct_el0\n\t"
+        : "=r" (cntvct_el0) : : );
+    return cntvct_el0;
+#elif defined(_POSIX_MONOTONIC_CLOCK) && _POSIX_MONOTONIC_CLOCK >= 0
+    struct timespec tp;
+    if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0)
+        std::abort();
+    return static_cast<uint64_t>(tp.tv_sec) * 1000000000ull + tp.tv_nsec;
+#else
+#error Unsupported architecture
+#endif
+
+#else
+#error Unknown compiler
+#endif
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+void current_utc_time(timespec * ts)
 {
 #if defined(__MACH__) // OS X does not have clock_gettime, use clock_get_time
     clock_serv_t cclock;
@@ -720,29 +2782,64 @@ double run_measure(
     return duration;
 }
 
-}
+// Measures the table driven UTF-8 decoder against the default one
+template<typename Och>
+void run_utf8_dfa_measure(
+    uint64_t const resolution,
+    std::vector<char> const & buf,
+    std::vector<Och> const & obuf)
+{
+    typedef utf::utf_selector_t<Och> outf_type;
 
-#if defined(WW898_ENABLE_PERFORMANCE_TESTS)
-#define WW898_PERFORMANCE_TESTS_MODE *boost::unit_test::enabled()
-#else
-#define WW898_PERFORMANCE_TESTS_MODE *boost::unit_test::disabled()
-#endif
+    std::vector<Och> res;
+    res.reserve(obuf.capacity());
+    auto const base_duration = measure(resolution, [&]
+        {
+            res.clear();
+            utf::conv<utf::utf8, outf_type>(&buf.front(), &buf.back() + 1, std::back_inserter(res));
+        });
+    auto const duration = measure(resolution, [&]
+        {
+            res.clear();
+            utf::conv<utf::utf8_dfa, outf_type>(&buf.front(), &buf.back() + 1, std::back_inserter(res));
+        });
+    auto const same = res.size() == obuf.size() && memcmp(&obuf.front(), &res.front(), sizeof(Och) * res.size()) == 0;
+    BOOST_TEST_REQUIRE(same);
 
-BOOST_AUTO_TEST_CASE(performance, WW898_PERFORMANCE_TESTS_MODE)
+    dump_name<char, Och>();
+    dump_duration(base_duration);
+    std::cout << ", utf8_dfa: ";
+    dump_duration(duration);
+    dump_difference(duration, base_duration);
+    dump_endl();
+}
+
+struct corpus final
 {
-    static size_t const symbol_count = 16 * 1024 * 1024;
+    std::vector<char    > u8 ;
+    std::vector<char16_t> u16;
+    std::vector<char32_t> u32;
+    std::vector<wchar_t > uw ;
+};
 
-    std::vector<char32_t> buf_u32;
+// Every `100 / ascii_percents` symbol is 7-bit, others are spread over `[min_cp‥max_cp]`
+corpus generate_corpus(
+    size_t const symbol_count,
+    size_t const ascii_percents,
+    uint32_t const min_cp = 0x80,
+    uint32_t const max_cp = utf::max_unicode_code_point)
+{
+    corpus res;
 
     {
         boost::random::mt19937 random(0);
         for (auto n = symbol_count; n-- > 0; )
         {
             uint32_t cp;
-            if (n % 4 == 0)
+            if (n * ascii_percents % 100 < ascii_percents)
                 cp = random() % 0x80;
             else
-                cp = random() % (utf::max_unicode_code_point + 1 - 0x80) + 0x80;
+                cp = random() % (max_cp + 1 - min_cp) + min_cp;
 
             if (utf::utf16::min_surrogate <= cp && cp <= utf::utf16::max_surrogate)
                 cp -= utf::utf16::min_surrogate;
@@ -753,17 +2850,40 @@ BOOST_AUTO_TEST_CASE(performance, WW898_PERFORMANCE_TESTS_MODE)
                 cp = 0xFEFF;
 #endif
 
-            buf_u32.push_back(cp);
+            res.u32.push_back(cp);
         }
     }
 
-    std::vector<char    > buf_u8 ;
-    std::vector<char16_t> buf_u16;
-    std::vector<wchar_t > buf_uw ;
+    utf::conv<utf::utf32, utf::utf8 >(res.u32.cbegin(), res.u32.cend(), std::back_inserter(res.u8 ));
+    utf::conv<utf::utf32, utf::utf16>(res.u32.cbegin(), res.u32.cend(), std::back_inserter(res.u16));
+    utf::conv<utf::utf32, utf::utfw >(res.u32.cbegin(), res.u32.cend(), std::back_inserter(res.uw ));
+    return res;
+}
+
+char const * const isa_names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+void dump_ascii_percents(size_t const ascii_percents)
+{
+    std::cout << "ascii: " << ascii_percents << "%" << std::endl;
+}
+
+}
+
+#if defined(WW898_ENABLE_PERFORMANCE_TESTS)
+#define WW898_PERFORMANCE_TESTS_MODE *boost::unit_test::enabled()
+#else
+#define WW898_PERFORMANCE_TESTS_MODE *boost::unit_test::disabled()
+#endif
+
+BOOST_AUTO_TEST_CASE(performance, WW898_PERFORMANCE_TESTS_MODE)
+{
+    static size_t const symbol_count = 16 * 1024 * 1024;
 
-    utf::conv<utf::utf32, utf::utf8 >(buf_u32.cbegin(), buf_u32.cend(), std::back_inserter(buf_u8 ));
-    utf::conv<utf::utf32, utf::utf16>(buf_u32.cbegin(), buf_u32.cend(), std::back_inserter(buf_u16));
-    utf::conv<utf::utf32, utf::utfw >(buf_u32.cbegin(), buf_u32.cend(), std::back_inserter(buf_uw ));
+    auto const mixed = generate_corpus(symbol_count, 25);
+    auto const & buf_u8  = mixed.u8 ;
+    auto const & buf_u16 = mixed.u16;
+    auto const & buf_u32 = mixed.u32;
+    auto const & buf_uw  = mixed.uw ;
 
     std::cout <<
 #if defined(_MSC_FULL_VER)
@@ -784,11 +2904,13 @@ BOOST_AUTO_TEST_CASE(performance, WW898_PERFORMANCE_TESTS_MODE)
 
         "__cpp_lib_string_view: " << std::dec << __cpp_lib_string_view << std::endl <<
         "sizeof wchar_t: " << sizeof(wchar_t) << std::endl <<
-        utf_namer<wchar_t >::value << ": UTF" << 8 * sizeof(wchar_t) << std::endl;
+        utf_namer<wchar_t >::value << ": UTF" << 8 * sizeof(wchar_t) << std::endl <<
+        "isa: " << isa_names[static_cast<size_t>(utf::active_isa())] << std::endl;
 
     auto const resolution = get_time_resolution();
     std::cout << "Resolution: " << resolution << std::endl;
 
+    dump_ascii_percents(25);
                                  run_measure(resolution, buf_u8 , buf_u8 );
     auto const u8_u16_duration = run_measure(resolution, buf_u8 , buf_u16);
                                  run_measure(resolution, buf_u8 , buf_u32);
@@ -894,6 +3016,370 @@ BOOST_AUTO_TEST_CASE(performance, WW898_PERFORMANCE_TESTS_MODE)
             dump_endl();
         }
     }
+
+    {
+        auto const ascii = generate_corpus(symbol_count, 95);
+
+        dump_ascii_percents(95);
+        run_measure(resolution, ascii.u8 , ascii.u8 );
+        run_measure(resolution, ascii.u8 , ascii.u16);
+        run_measure(resolution, ascii.u8 , ascii.u32);
+        run_measure(resolution, ascii.u8 , ascii.uw );
+        run_measure(resolution, ascii.u16, ascii.u8 );
+        run_measure(resolution, ascii.u16, ascii.u16);
+        run_measure(resolution, ascii.u16, ascii.u32);
+        run_measure(resolution, ascii.u16, ascii.uw );
+        run_measure(resolution, ascii.u32, ascii.u8 );
+        run_measure(resolution, ascii.u32, ascii.u16);
+        run_measure(resolution, ascii.u32, ascii.u32);
+        run_measure(resolution, ascii.u32, ascii.uw );
+        run_measure(resolution, ascii.uw , ascii.u8 );
+        run_measure(resolution, ascii.uw , ascii.u16);
+        run_measure(resolution, ascii.uw , ascii.u32);
+        run_measure(resolution, ascii.uw , ascii.uw );
+    }
+
+    {
+        std::cout << "utf8_dfa:" << std::endl;
+        struct
+        {
+            char const * name;
+            corpus value;
+        } const corpora[] =
+        {
+            { "ascii", generate_corpus(symbol_count, 100) },
+            { "latin", generate_corpus(symbol_count, 70, 0xA0, 0x24F) },
+            { "cjk  ", generate_corpus(symbol_count, 0, 0x4E00, 0x9FFF) },
+            { "mixed", mixed }
+        };
+        for (auto const & item : corpora)
+        {
+            std::cout << item.name << ": ";
+            run_utf8_dfa_measure(resolution, item.value.u8, item.value.u16);
+            std::cout << item.name << ": ";
+            run_utf8_dfa_measure(resolution, item.value.u8, item.value.u32);
+        }
+    }
+
+    {
+        std::cout << "parallel_conv, threads: " << std::thread::hardware_concurrency() << std::endl;
+        std::vector<char16_t> res;
+        auto const duration = measure(resolution, [&]
+            {
+                res.clear();
+                utf::parallel_conv<utf::utf8, utf::utf16>(&buf_u8.front(), &buf_u8.back() + 1, res);
+            });
+        auto const same = res.size() == buf_u16.size() && memcmp(&buf_u16.front(), &res.front(), sizeof(char16_t) * res.size()) == 0;
+        BOOST_TEST_REQUIRE(same);
+
+        dump_name<char, char16_t>();
+        dump_duration(duration);
+        dump_difference(duration, u8_u16_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "size:" << std::endl;
+        size_t total_cp = 0;
+        auto const scalar_duration = measure(resolution, [&]
+            {
+                total_cp = utf::size<utf::utf8>(buf_u8.cbegin(), buf_u8.cend());
+            });
+        auto const bulk_duration = measure(resolution, [&]
+            {
+                BOOST_TEST_REQUIRE(utf::size<utf::utf8>(&buf_u8.front(), &buf_u8.back() + 1) == total_cp);
+            });
+
+        std::cout << "scalar: UTF8 : ";
+        dump_duration(scalar_duration);
+        dump_endl();
+        std::cout << "bulk  : UTF8 : ";
+        dump_duration(bulk_duration);
+        dump_difference(bulk_duration, scalar_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "cp_index, lookups: 1024" << std::endl;
+        auto const first = &buf_u8.front();
+        auto const eit = &buf_u8.back() + 1;
+        auto const total_cp = utf::size<utf::utf8>(first, eit);
+        std::vector<size_t> cps;
+        boost::random::mt19937 random(0);
+        for (size_t n = 0; n < 1024; ++n)
+            cps.push_back(random() % total_cp);
+        for (size_t const step : { 16, 64, 128, 512, 4096 })
+        {
+            auto const build_duration = measure(resolution, [&]
+                {
+                    BOOST_TEST_REQUIRE(utf::make_cp_index(first, eit, step).size() == total_cp);
+                });
+            auto const index = utf::make_cp_index(first, eit, step);
+            size_t sum = 0;
+            auto const lookup_duration = measure(resolution, [&]
+                {
+                    for (auto const cp : cps)
+                        sum += index.code_point(index.offset(cp)) - cp;
+                });
+            BOOST_TEST_REQUIRE(sum == 0);
+
+            std::cout << "step " << std::setfill(' ') << std::left << std::setw(4) << step << ": build ";
+            dump_duration(build_duration);
+            std::cout << ", lookup ";
+            dump_duration(lookup_duration);
+            std::cout << ", memory " << index.marks() * sizeof(size_t) << " bytes";
+            dump_endl();
+        }
+    }
+
+    {
+        std::cout << "offsets, UTF-16 ==> UTF-8:" << std::endl;
+        auto const first = &buf_u8.front();
+        auto const eit = &buf_u8.back() + 1;
+        auto const target = buf_u16.size() - 1;
+        size_t offset = 0;
+        auto const scalar_duration = measure(resolution, [&]
+            {
+                auto it = first;
+                size_t units = 0;
+                while (units < target)
+                {
+                    auto const symbol = it;
+                    units += utf::detail::units<utf::utf16>(utf::utf8::read([&it] { return *it++; }));
+                    if (units > target)
+                        it = symbol;
+                }
+                offset = static_cast<size_t>(it - first);
+            });
+        auto const bulk_duration = measure(resolution, [&]
+            {
+                BOOST_TEST_REQUIRE(utf::utf16_to_utf8_offset(first, eit, target) == offset);
+            });
+
+        std::cout << "scalar: ";
+        dump_duration(scalar_duration);
+        dump_endl();
+        std::cout << "bulk  : ";
+        dump_duration(bulk_duration);
+        dump_difference(bulk_duration, scalar_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "truncate_codepoints:" << std::endl;
+        auto const max_cp = utf::size<utf::utf8>(&buf_u8.front(), &buf_u8.back() + 1) / 2;
+        size_t offset = 0;
+        auto const scalar_duration = measure(resolution, [&]
+            {
+                offset = static_cast<size_t>(utf::truncate_codepoints<utf::utf8>(buf_u8.cbegin(), buf_u8.cend(), max_cp) - buf_u8.cbegin());
+            });
+        auto const bulk_duration = measure(resolution, [&]
+            {
+                BOOST_TEST_REQUIRE(utf::truncate_codepoints<utf::utf8>(&buf_u8.front(), &buf_u8.back() + 1, max_cp) == &buf_u8.front() + offset);
+            });
+
+        std::cout << "scalar: UTF8 : ";
+        dump_duration(scalar_duration);
+        dump_endl();
+        std::cout << "bulk  : UTF8 : ";
+        dump_duration(bulk_duration);
+        dump_difference(bulk_duration, scalar_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "swapped conv:" << std::endl;
+        std::vector<char16_t> swapped(buf_u16.size());
+        for (size_t n = 0; n < buf_u16.size(); ++n)
+            swapped[n] = static_cast<char16_t>(swapped_u16::swap(buf_u16[n]));
+        std::string res;
+        auto const preswap_duration = measure(resolution, [&]
+            {
+                std::vector<char16_t> tmp(swapped.size());
+                for (size_t n = 0; n < swapped.size(); ++n)
+                    tmp[n] = static_cast<char16_t>(swapped_u16::swap(swapped[n]));
+                res.clear();
+                utf::conv<utf::utf16, utf::utf8>(tmp.data(), tmp.data() + tmp.size(), std::back_inserter(res));
+            });
+        auto const bulk_duration = measure(resolution, [&]
+            {
+                res.clear();
+                utf::conv<swapped_u16, utf::utf8>(swapped.data(), swapped.data() + swapped.size(), std::back_inserter(res));
+            });
+        auto const same = res.size() == buf_u8.size() && memcmp(&buf_u8.front(), &res.front(), res.size()) == 0;
+        BOOST_TEST_REQUIRE(same);
+
+        std::cout << "preswap: UTF16 => UTF8 : ";
+        dump_duration(preswap_duration);
+        dump_endl();
+        std::cout << "bulk   : UTF16 => UTF8 : ";
+        dump_duration(bulk_duration);
+        dump_difference(bulk_duration, preswap_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "detect_encoding:" << std::endl;
+        std::string u16be(buf_u16.size() * 2, '\0');
+        for (size_t n = 0; n < buf_u16.size(); ++n)
+        {
+            auto const ch = swapped_u16::swap(buf_u16[n]);
+            std::memcpy(&u16be[n * 2], &ch, 2);
+        }
+        std::vector<std::string> const samples =
+        {
+            std::string(buf_u8.cbegin(), buf_u8.cend()),
+            std::string(reinterpret_cast<char const *>(&buf_u16.front()), buf_u16.size() * 2),
+            u16be,
+            std::string(reinterpret_cast<char const *>(&buf_u32.front()), buf_u32.size() * 4)
+        };
+        utf::encoding const encodings[] = { utf::encoding::utf8, utf::encoding::utf16le, utf::encoding::utf16be, utf::encoding::utf32le };
+        size_t total_size = 0;
+        auto const known_duration = measure(resolution, [&]
+            {
+                total_size = 0;
+                for (size_t n = 0; n < samples.size(); ++n)
+                    total_size += utf::visit_encoding(encodings[n], bytes_decoder{samples[n], 0}).size();
+            });
+        auto const detect_duration = measure(resolution, [&]
+            {
+                size_t size = 0;
+                for (auto const & sample : samples)
+                {
+                    auto const detected = utf::detect_encoding(sample);
+                    size += utf::visit_encoding(detected.value, bytes_decoder{sample, detected.bom_size}).size();
+                }
+                BOOST_TEST_REQUIRE(size == total_size);
+            });
+
+        std::cout << "known : ";
+        dump_duration(known_duration);
+        dump_endl();
+        std::cout << "detect: ";
+        dump_duration(detect_duration);
+        dump_difference(detect_duration, known_duration);
+        dump_endl();
+    }
+
+    {
+        std::cout << "latin1:" << std::endl;
+        std::vector<uint8_t> latin1;
+        boost::random::mt19937 random(0);
+        for (size_t n = 0; n < buf_u8.size(); ++n)
+            latin1.push_back(static_cast<uint8_t>(n % 16 ? random() % 0x80 : random() % 0x100));
+        std::vector<char> u8;
+        std::vector<char16_t> u16;
+        u8.reserve(latin1.size() * 2);
+        u16.reserve(latin1.size());
+        std::vector<uint8_t> res;
+        res.reserve(latin1.size());
+        auto const scalar_u8_duration = measure(resolution, [&]
+            {
+                u8.clear();
+                utf::conv<utf::latin1, utf::utf8>(latin1.cbegin(), latin1.cend(), std::back_inserter(u8));
+            });
+        auto const bulk_u8_duration = measure(resolution, [&]
+            {
+                u8.clear();
+                utf::conv<utf::latin1, utf::utf8>(latin1.data(), latin1.data() + latin1.size(), std::back_inserter(u8));
+            });
+        auto const scalar_u16_duration = measure(resolution, [&]
+            {
+                u16.clear();
+                utf::conv<utf::latin1, utf::utf16>(latin1.cbegin(), latin1.cend(), std::back_inserter(u16));
+            });
+        auto const bulk_u16_duration = measure(resolution, [&]
+            {
+                u16.clear();
+                utf::conv<utf::latin1, utf::utf16>(latin1.data(), latin1.data() + latin1.size(), std::back_inserter(u16));
+            });
+        auto const scalar_back_duration = measure(resolution, [&]
+            {
+                res.clear();
+                utf::conv<utf::utf8, utf::latin1>(u8.cbegin(), u8.cend(), std::back_inserter(res));
+            });
+        auto const bulk_back_duration = measure(resolution, [&]
+            {
+                res.clear();
+                utf::conv<utf::utf8, utf::latin1>(u8.data(), u8.data() + u8.size(), std::back_inserter(res));
+            });
+        BOOST_TEST_REQUIRE((res == latin1));
+
+        std::cout << "latin1 -> u8 scalar : ";
+        dump_duration(scalar_u8_duration);
+        dump_endl();
+        std::cout << "latin1 -> u8 bulk   : ";
+        dump_duration(bulk_u8_duration);
+        dump_difference(bulk_u8_duration, scalar_u8_duration);
+        dump_endl();
+        std::cout << "latin1 -> u16 scalar: ";
+        dump_duration(scalar_u16_duration);
+        dump_endl();
+        std::cout << "latin1 -> u16 bulk  : ";
+        dump_duration(bulk_u16_duration);
+        dump_difference(bulk_u16_duration, scalar_u16_duration);
+        dump_endl();
+        std::cout << "u8 -> latin1 scalar : ";
+        dump_duration(scalar_back_duration);
+        dump_endl();
+        std::cout << "u8 -> latin1 bulk   : ";
+        dump_duration(bulk_back_duration);
+        dump_difference(bulk_back_duration, scalar_back_duration);
+        dump_endl();
+    }
+
+    {
+        // Every 64th char of UTF-8 is broken
+        std::vector<char> broken(buf_u8.cbegin(), buf_u8.cbegin() + 1024 * 1024);
+        for (size_t n = 0; n < broken.size(); n += 64)
+            broken[n] = '\xFF';
+
+        std::cout << "broken: 1/64" << std::endl;
+
+        std::vector<char16_t> res;
+        res.reserve(broken.size());
+        auto const catch_duration = measure(resolution, [&]
+            {
+                res.clear();
+                auto it = broken.cbegin();
+                auto const eit = broken.cend();
+                auto const read_fn = [&it, &eit]
+                    {
+                        if (it == eit)
+                            throw std::runtime_error("Not enough input");
+                        return *it++;
+                    };
+                auto const write_fn = [&res] (char16_t const ch) { res.push_back(ch); };
+                while (it != eit)
+                {
+                    auto const symbol = it;
+                    try
+                    {
+                        utf::utf16::write(utf::utf8::read(read_fn), write_fn);
+                    }
+                    catch (std::runtime_error const &)
+                    {
+                        it = symbol + 1;
+                        utf::utf16::write(utf::replacement_code_point, write_fn);
+                    }
+                }
+            });
+        std::cout << "catch and retry : ";
+        dump_name<char, char16_t>();
+        dump_duration(catch_duration);
+        dump_endl();
+
+        auto const replace_duration = measure(resolution, [&]
+            {
+                res.clear();
+                utf::conv<utf::utf8, utf::utf16, utf::error_replace>(&broken.front(), &broken.back() + 1, std::back_inserter(res));
+            });
+        std::cout << "error_replace   : ";
+        dump_name<char, char16_t>();
+        dump_duration(replace_duration);
+        dump_difference(replace_duration, catch_duration);
+        dump_endl();
+    }
 }
 
 BOOST_AUTO_TEST_CASE(example, WW898_PERFORMANCE_TESTS_MODE)
@@ -931,3 +3417,6 @@ BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_TEST_DONT_PRINT_LOG_VALUE(ww898::test::utf_converters::unicode_tuple)
 BOOST_TEST_DONT_PRINT_LOG_VALUE(ww898::test::utf_converters::supported_tuple)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ww898::test::utf_converters::malformed_tuple<char>)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ww898::test::utf_converters::malformed_tuple<char16_t>)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ww898::test::utf_converters::malformed_tuple<char32_t>)
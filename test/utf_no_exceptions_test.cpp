@@ -0,0 +1,103 @@
+﻿/*
+ * MIT License
+ * 
+ * Copyright (c) 2017-2019 Mikhail Pilin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *  
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *  
+ * THE SOFTWARE IS PROVIDED "AS IS{ WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ww898/utf_converters.hpp>
+#include <ww898/utf_batch.hpp>
+#include <ww898/utf_sizes.hpp>
+#include <ww898/utf_validate.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compiled with the exceptions disabled, only the non-throwing error policies are used
+
+#if defined(WW898_UTF_EXCEPTIONS)
+#error The exceptions should be disabled
+#endif
+
+namespace {
+
+using namespace ww898::utf;
+
+template<
+    typename Outf,
+    typename Och,
+    typename Ch>
+bool check_policies(std::basic_string<Ch> const & str, std::basic_string<Och> const & replaced)
+{
+    std::u32string cps;
+    for (auto const cp : conv<char32_t, error_skip>(replaced))
+        if (cp != replacement_code_point)
+            cps += cp;
+    auto const skipped = conv<Och, error_skip>(cps);
+    std::vector<Och> stopped;
+    auto const status = conv<utf_selector_t<Ch>, Outf, error_stop>(str.begin(), str.end(), std::back_inserter(stopped));
+    return
+        conv<Och, error_replace>(str) == replaced &&
+        conv<Och, error_skip>(str) == skipped &&
+        convz<Och, error_replace>(str.c_str()) == replaced &&
+        size<utf_selector_t<Ch>, error_skip>(str.c_str()) <= str.size() &&
+        status.error != utf_error::none &&
+        !is_valid(str);
+}
+
+bool check_batch()
+{
+    std::vector<std::u16string> const values{u"\x41\xD800", u"", u"\u20AC long enough for the kernels"};
+    std::string data;
+    std::vector<uint32_t> offsets;
+    batch_conv<error_replace>(values.cbegin(), values.cend(), data, offsets);
+    // The worst case size does not fit the offset type
+    std::vector<std::u16string> const long_values(1, std::u16string(100, u'a'));
+    std::string long_data("stale");
+    std::vector<uint8_t> long_offsets(1);
+    batch_conv<error_replace>(long_values.cbegin(), long_values.cend(), long_data, long_offsets);
+    return
+        data == "A\xEF\xBF\xBD\xE2\x82\xAC long enough for the kernels" &&
+        offsets == std::vector<uint32_t>{0, 4, 4, 35} &&
+        long_data.empty() &&
+        long_offsets.empty();
+}
+
+}
+
+int main()
+{
+    std::string const u8("\x41\xD0\x96\xFF\xE2\x82\xAC\xF0\x9F\x98\x80 long enough for the kernels \xC0");
+    std::u16string const u16(u"\x41\u0416\xD800\u20AC\U0001F600 long enough for the kernels \xDC00");
+    std::u32string const u32(U"\x41\u0416\x80000000\u20AC\U0001F600 long enough for the kernels \x110000");
+    std::string narrow;
+    conv<utf8, latin1, error_replace>(u8.begin(), u8.end(), std::back_inserter(narrow));
+    auto const success =
+        narrow == "A???? long enough for the kernels ?" &&
+        check_policies<utf16>(u8, std::u16string(u"A\u0416\uFFFD\u20AC\U0001F600 long enough for the kernels \uFFFD")) &&
+        check_policies<utf32>(u8, std::u32string(U"A\u0416\uFFFD\u20AC\U0001F600 long enough for the kernels \uFFFD")) &&
+        check_policies<utf8>(u16, std::string("A\xD0\x96\xEF\xBF\xBD\xE2\x82\xAC\xF0\x9F\x98\x80 long enough for the kernels \xEF\xBF\xBD")) &&
+        check_policies<utf32>(u16, std::u32string(U"A\u0416\uFFFD\u20AC\U0001F600 long enough for the kernels \uFFFD")) &&
+        check_policies<utf8>(u32, std::string("A\xD0\x96\xEF\xBF\xBD\xE2\x82\xAC\xF0\x9F\x98\x80 long enough for the kernels \xF4\x90\x80\x80")) &&
+        check_policies<utf16>(u32, std::u16string(u"A\u0416\uFFFD\u20AC\U0001F600 long enough for the kernels \uFFFD")) &&
+        check_batch();
+    return success ? 0 : 1;
+}